@@ -0,0 +1,33 @@
+#ifndef VG_CORE_MAPPEDFILE_HPP
+#define VG_CORE_MAPPEDFILE_HPP
+
+#include <cstddef>
+#include "platform.hpp"
+
+namespace vg
+{
+    // This describes the abstract behaviour of a file mapped into memory.
+    // See the MappedFile class under an OS implementation for the version
+    // of an AbstractMappedFile actually used for the platform.
+    //
+    // The mapping is copy-on-write: pages are read from the file as they're
+    // touched and shared with the OS file cache, and writing to them makes a
+    // private copy of the page. The file itself is never changed.
+    class AbstractMappedFile
+    {
+        public:
+            virtual ~AbstractMappedFile()
+            {
+            }
+
+            // The file's contents, or null if it couldn't be opened or mapped.
+            virtual unsigned char* getData() const = 0;
+            virtual size_t getSize() const = 0;
+    };
+}
+
+#ifdef VG_WIN32
+#include "os/windows/mappedfile.hpp"
+#endif
+
+#endif
\ No newline at end of file
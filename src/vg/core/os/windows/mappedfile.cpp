@@ -0,0 +1,63 @@
+#include "../../mappedfile.hpp"
+
+namespace vg
+{
+    MappedFile::MappedFile(const char* filename):
+        fileHandle(INVALID_HANDLE_VALUE),
+        mappingHandle(NULL),
+        data(NULL),
+        size(0)
+    {
+        fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if(fileHandle == INVALID_HANDLE_VALUE)
+        {
+            return;
+        }
+
+        // Empty files can't be mapped, and ones bigger than the address space won't fit.
+        LARGE_INTEGER fileSize;
+        if(!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart <= 0
+            || (unsigned long long) fileSize.QuadPart > (unsigned long long) (size_t) -1)
+        {
+            return;
+        }
+
+        // PAGE_WRITECOPY and FILE_MAP_COPY give each writer its own copy of a page.
+        mappingHandle = CreateFileMapping(fileHandle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        if(!mappingHandle)
+        {
+            return;
+        }
+        data = (unsigned char*) MapViewOfFile(mappingHandle, FILE_MAP_COPY, 0, 0, 0);
+        if(data)
+        {
+            size = size_t(fileSize.QuadPart);
+        }
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if(data)
+        {
+            UnmapViewOfFile(data);
+        }
+        if(mappingHandle)
+        {
+            CloseHandle(mappingHandle);
+        }
+        if(fileHandle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(fileHandle);
+        }
+    }
+
+    unsigned char* MappedFile::getData() const
+    {
+        return data;
+    }
+
+    size_t MappedFile::getSize() const
+    {
+        return size;
+    }
+}
\ No newline at end of file
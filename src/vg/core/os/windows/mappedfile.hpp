@@ -0,0 +1,27 @@
+#ifndef VG_CORE_OS_WINDOWS_MAPPEDFILE_HPP
+#define VG_CORE_OS_WINDOWS_MAPPEDFILE_HPP
+
+#include "platform.hpp"
+
+namespace vg
+{
+    class AbstractMappedFile;
+    class MappedFile : public AbstractMappedFile
+    {
+        private:
+            HANDLE fileHandle;
+            HANDLE mappingHandle;
+            unsigned char* data;
+            size_t size;
+
+        public:
+            MappedFile(const char* filename);
+            ~MappedFile();
+
+            // Implementation of AbstractMappedFile
+            unsigned char* getData() const;
+            size_t getSize() const;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -1,8 +1,8 @@
-#ifndef VG_CORE_OS_WINDOWS_PLATFORM_HPP
-#define VG_CORE_OS_WINDOWS_PLATFORM_HPP
-
-#define WIN32_LEAN_AND_MEAN
-#define NOMINMAX
-#include <windows.h>
-
-#endif
+#ifndef VG_CORE_OS_WINDOWS_PLATFORM_HPP
+#define VG_CORE_OS_WINDOWS_PLATFORM_HPP
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+#endif
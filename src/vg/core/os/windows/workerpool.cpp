@@ -0,0 +1,108 @@
+#include "../../workerpool.hpp"
+
+namespace vg
+{
+    DWORD WINAPI WorkerPool::handleThread(LPVOID parameter)
+    {
+        WorkerPool* pool = (WorkerPool*) parameter;
+        while(true)
+        {
+            WaitForSingleObject(pool->startSemaphore, INFINITE);
+            if(pool->stopping)
+            {
+                break;
+            }
+            pool->work();
+            if(InterlockedDecrement(&pool->runningThreads) == 0)
+            {
+                SetEvent(pool->doneEvent);
+            }
+        }
+        return 0;
+    }
+
+    WorkerPool::WorkerPool(int threadCount):
+        task(NULL),
+        count(0),
+        nextIndex(0),
+        runningThreads(0),
+        stopping(false)
+    {
+        if(threadCount <= 0)
+        {
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            threadCount = info.dwNumberOfProcessors;
+        }
+
+        // The thread calling run() works too, so it needs one fewer.
+        startSemaphore = CreateSemaphore(NULL, 0, threadCount, NULL);
+        doneEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+        InitializeCriticalSection(&runLock);
+        for(int i = 0; i < threadCount - 1; i++)
+        {
+            HANDLE thread = CreateThread(NULL, 0, handleThread, this, 0, NULL);
+            if(thread)
+            {
+                threads.push_back(thread);
+            }
+        }
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        stopping = true;
+        if(!threads.empty())
+        {
+            ReleaseSemaphore(startSemaphore, LONG(threads.size()), NULL);
+        }
+        for(size_t i = 0; i < threads.size(); i++)
+        {
+            WaitForSingleObject(threads[i], INFINITE);
+            CloseHandle(threads[i]);
+        }
+        DeleteCriticalSection(&runLock);
+        CloseHandle(doneEvent);
+        CloseHandle(startSemaphore);
+    }
+
+    void WorkerPool::work()
+    {
+        while(true)
+        {
+            LONG index = InterlockedIncrement(&nextIndex) - 1;
+            if(index >= count)
+            {
+                break;
+            }
+            task->run(index);
+        }
+    }
+
+    int WorkerPool::getThreadCount() const
+    {
+        return int(threads.size()) + 1;
+    }
+
+    void WorkerPool::run(Task& task, int count)
+    {
+        // Only one task at a time; other callers wait their turn.
+        EnterCriticalSection(&runLock);
+        this->task = &task;
+        this->count = count;
+        nextIndex = 0;
+        if(threads.empty() || count <= 1)
+        {
+            work();
+        }
+        else
+        {
+            runningThreads = LONG(threads.size());
+            ReleaseSemaphore(startSemaphore, LONG(threads.size()), NULL);
+            work();
+            WaitForSingleObject(doneEvent, INFINITE);
+        }
+        this->task = NULL;
+        LeaveCriticalSection(&runLock);
+    }
+}
\ No newline at end of file
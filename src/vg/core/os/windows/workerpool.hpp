@@ -0,0 +1,38 @@
+#ifndef VG_CORE_OS_WINDOWS_WORKERPOOL_HPP
+#define VG_CORE_OS_WINDOWS_WORKERPOOL_HPP
+
+#include <vector>
+#include "platform.hpp"
+
+namespace vg
+{
+    class AbstractWorkerPool;
+    class WorkerPool : public AbstractWorkerPool
+    {
+        private:
+            static DWORD WINAPI handleThread(LPVOID parameter);
+
+            std::vector<HANDLE> threads;
+            HANDLE startSemaphore;
+            HANDLE doneEvent;
+            CRITICAL_SECTION runLock;
+
+            Task* task;
+            LONG count;
+            volatile LONG nextIndex;
+            volatile LONG runningThreads;
+            volatile bool stopping;
+
+            void work();
+        public:
+            // A thread count of 0 means one thread per processor.
+            WorkerPool(int threadCount = 0);
+            ~WorkerPool();
+
+            // Implementation of AbstractWorkerPool
+            int getThreadCount() const;
+            void run(Task& task, int count);
+    };
+}
+
+#endif
\ No newline at end of file
@@ -1,6 +1,6 @@
-#include "window.hpp"
-
-namespace vg
-{
-    const char* const AbstractWindow::DefaultTitle = "verge";
+#include "window.hpp"
+
+namespace vg
+{
+    const char* const AbstractWindow::DefaultTitle = "verge";
 }
\ No newline at end of file
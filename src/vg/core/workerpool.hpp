@@ -0,0 +1,66 @@
+#ifndef VG_CORE_WORKERPOOL_HPP
+#define VG_CORE_WORKERPOOL_HPP
+
+#include "platform.hpp"
+
+namespace vg
+{
+    // This describes the abstract behaviour of a pool of worker threads.
+    // See the WorkerPool class under an OS implementation for the version
+    // of an AbstractWorkerPool actually used for the platform.
+    class AbstractWorkerPool
+    {
+        public:
+            // A job split into numbered pieces, which may run in any order and
+            // on any thread, so pieces must not write to anything they share.
+            class Task
+            {
+                public:
+                    virtual ~Task()
+                    {
+                    }
+
+                    virtual void run(int index) = 0;
+            };
+
+            virtual ~AbstractWorkerPool()
+            {
+            }
+
+            // The number of threads working on a task, including the caller's.
+            virtual int getThreadCount() const = 0;
+            // Runs task pieces 0..count-1, and returns once they're all done.
+            // The calling thread works on pieces too.
+            virtual void run(Task& task, int count) = 0;
+    };
+
+    template<typename Function> class FunctionTask : public AbstractWorkerPool::Task
+    {
+        private:
+            Function function;
+
+        public:
+            FunctionTask(Function function):
+                function(function)
+            {
+            }
+
+            void run(int index)
+            {
+                function(index);
+            }
+    };
+
+    // Runs function(index) for each index 0..count-1 on the pool.
+    template<typename Function> void runTask(AbstractWorkerPool* pool, int count, Function function)
+    {
+        FunctionTask<Function> task(function);
+        pool->run(task, count);
+    }
+}
+
+#ifdef VG_WIN32
+#include "os/windows/workerpool.hpp"
+#endif
+
+#endif
\ No newline at end of file
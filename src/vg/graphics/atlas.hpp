@@ -0,0 +1,269 @@
+#ifndef VG_GRAPHICS_ATLAS_HPP
+#define VG_GRAPHICS_ATLAS_HPP
+
+#include <vector>
+#include <algorithm>
+#include "blend.hpp"
+#include "color.hpp"
+#include "image.hpp"
+
+namespace vg
+{
+    // Where a sprite ended up in an atlas: the rectangle x, y - x2, y2 of image,
+    // which goes offsetX, offsetY into the untrimmed sprite. A sprite with no
+    // visible pixels has no image, and draws nothing.
+    struct AtlasRegion
+    {
+        Image* image;
+        int x, y, x2, y2;
+        int offsetX, offsetY;
+        // Size of the sprite before its transparent borders were trimmed.
+        int width, height;
+
+        // Draws the sprite as if it were the original, untrimmed Image.
+        template<typename BlendFunction> void draw(int destX, int destY, Image* dest, BlendFunction f) const
+        {
+            if(image)
+            {
+                image->drawRegion(x, y, x2, y2, destX + offsetX, destY + offsetY, dest, f);
+            }
+        }
+    };
+
+    // Packs many small sprites into a few large atlas Images, so they share
+    // memory and draws from them stay close together. Transparent borders are
+    // trimmed off first, and AtlasRegion puts the offset back when drawing.
+    //
+    // Add sprites, then build(). Sprites are packed tallest first with a
+    // bottom-left skyline, opening a new atlas when one fills up. Sprites added
+    // after a build go into the space left by the next one, and the handles
+    // from before stay good. The atlases belong to the builder, so it has to
+    // outlive the regions.
+    class AtlasBuilder
+    {
+        private:
+            struct Entry
+            {
+                Image* source;
+                // The trimmed rectangle in the source.
+                int x, y, x2, y2;
+            };
+
+            // One run of the skyline: the top of the used area from x to x + width.
+            struct Segment
+            {
+                int x, y, width;
+            };
+
+            int atlasWidth, atlasHeight;
+            int padding;
+            std::vector<Entry> entries;
+            std::vector<AtlasRegion> regions;
+            std::vector<Image*> atlases;
+            std::vector<std::vector<Segment> > skylines;
+
+            // Finds the lowest, then leftmost, place for a width by height box on a skyline.
+            // Returns false if it doesn't fit.
+            static bool findPlace(const std::vector<Segment>& skyline, int width, int height, int limitWidth, int limitHeight,
+                int& bestX, int& bestY, size_t& bestSegment)
+            {
+                bool found = false;
+                for(size_t i = 0; i < skyline.size(); i++)
+                {
+                    int x = skyline[i].x;
+                    if(x + width > limitWidth)
+                    {
+                        break;
+                    }
+                    // The box rests on the highest segment it spans.
+                    int y = 0;
+                    int covered = 0;
+                    for(size_t j = i; covered < width; j++)
+                    {
+                        y = std::max(y, skyline[j].y);
+                        covered += skyline[j].width;
+                    }
+                    if(y + height <= limitHeight && (!found || y < bestY || (y == bestY && x < bestX)))
+                    {
+                        found = true;
+                        bestX = x;
+                        bestY = y;
+                        bestSegment = i;
+                    }
+                }
+                return found;
+            }
+
+            // Raises the skyline under a box placed at segment.
+            static void place(std::vector<Segment>& skyline, size_t segment, int width, int height, int y)
+            {
+                Segment top = {skyline[segment].x, y + height, width};
+                int right = top.x + width;
+
+                // Cut away everything the box covers, keeping any part sticking out past it.
+                size_t end = segment;
+                while(end < skyline.size() && skyline[end].x < right)
+                {
+                    end++;
+                }
+                Segment& last = skyline[end - 1];
+                int lastRight = last.x + last.width;
+                if(lastRight > right)
+                {
+                    last.width = lastRight - right;
+                    last.x = right;
+                    end--;
+                }
+                skyline.erase(skyline.begin() + segment, skyline.begin() + end);
+                skyline.insert(skyline.begin() + segment, top);
+
+                // Join neighbours at the same height.
+                for(size_t i = 0; i + 1 < skyline.size();)
+                {
+                    if(skyline[i].y == skyline[i + 1].y)
+                    {
+                        skyline[i].width += skyline[i + 1].width;
+                        skyline.erase(skyline.begin() + i + 1);
+                    }
+                    else
+                    {
+                        i++;
+                    }
+                }
+            }
+
+            void addAtlas(int width, int height)
+            {
+                Image* atlas = new Image(width, height);
+                atlas->clear(Color(0u));
+                atlases.push_back(atlas);
+                Segment floor = {0, 0, width};
+                skylines.push_back(std::vector<Segment>(1, floor));
+            }
+
+        public:
+            // Atlases are atlasWidth by atlasHeight, or bigger for a sprite that
+            // wouldn't fit otherwise. Padding leaves transparent pixels between
+            // sprites, so filtered scaling doesn't pick up their neighbours.
+            AtlasBuilder(int atlasWidth, int atlasHeight, int padding = 0):
+                atlasWidth(atlasWidth), atlasHeight(atlasHeight),
+                padding(padding)
+            {
+            }
+
+            ~AtlasBuilder()
+            {
+                for(size_t i = 0; i < atlases.size(); i++)
+                {
+                    delete atlases[i];
+                }
+            }
+
+            // Queues a sprite, trimmed down to its pixels that aren't fully transparent.
+            // Returns a handle for getRegion once it's built. The source only needs
+            // to last until build().
+            int add(Image* source)
+            {
+                Entry entry = {source, source->getWidth(), source->getHeight(), -1, -1};
+                for(int i = 0; i < source->getHeight(); i++)
+                {
+                    const AlphaRowInfo& info = source->getAlphaRowInfo(i);
+                    if(info.left <= info.right)
+                    {
+                        entry.x = std::min(entry.x, info.left);
+                        entry.x2 = std::max(entry.x2, info.right);
+                        entry.y = std::min(entry.y, i);
+                        entry.y2 = i;
+                    }
+                }
+                entries.push_back(entry);
+                return int(regions.size() + entries.size()) - 1;
+            }
+
+            // Packs every sprite queued since the last build and copies it into the atlases.
+            void build()
+            {
+                // Earlier builds' regions stay where they are, and the new ones go after them.
+                size_t first = regions.size();
+                // Tallest first packs a skyline tightest.
+                std::vector<int> order;
+                for(size_t i = 0; i < entries.size(); i++)
+                {
+                    order.push_back(int(i));
+                }
+                std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+                {
+                    return entries[a].y2 - entries[a].y > entries[b].y2 - entries[b].y;
+                });
+
+                regions.resize(first + entries.size());
+                for(size_t k = 0; k < order.size(); k++)
+                {
+                    const Entry& entry = entries[order[k]];
+                    AtlasRegion& region = regions[first + order[k]];
+                    region.width = entry.source->getWidth();
+                    region.height = entry.source->getHeight();
+                    region.image = 0;
+                    region.x = region.y = region.x2 = region.y2 = 0;
+                    region.offsetX = region.offsetY = 0;
+                    if(entry.x > entry.x2)
+                    {
+                        continue;
+                    }
+
+                    int width = entry.x2 - entry.x + 1;
+                    int height = entry.y2 - entry.y + 1;
+                    int boxWidth = width + padding;
+                    int boxHeight = height + padding;
+
+                    // Try the open atlases in order, then start a new one.
+                    size_t atlas = 0;
+                    int x = 0;
+                    int y = 0;
+                    size_t segment = 0;
+                    for(; atlas < atlases.size(); atlas++)
+                    {
+                        if(findPlace(skylines[atlas], boxWidth, boxHeight, atlases[atlas]->getWidth(), atlases[atlas]->getHeight(), x, y, segment))
+                        {
+                            break;
+                        }
+                    }
+                    if(atlas == atlases.size())
+                    {
+                        addAtlas(std::max(atlasWidth, boxWidth), std::max(atlasHeight, boxHeight));
+                        findPlace(skylines[atlas], boxWidth, boxHeight, atlases[atlas]->getWidth(), atlases[atlas]->getHeight(), x, y, segment);
+                    }
+                    place(skylines[atlas], segment, boxWidth, boxHeight, y);
+
+                    Image* image = atlases[atlas];
+                    entry.source->drawRegion(entry.x, entry.y, entry.x2, entry.y2, x, y, image, CopyBlender());
+                    region.image = image;
+                    region.x = x;
+                    region.y = y;
+                    region.x2 = x + width - 1;
+                    region.y2 = y + height - 1;
+                    region.offsetX = entry.x;
+                    region.offsetY = entry.y;
+                }
+                entries.clear();
+            }
+
+            // The reference only lasts until the next build, but the handle doesn't change.
+            const AtlasRegion& getRegion(int handle) const
+            {
+                return regions[handle];
+            }
+
+            int getAtlasCount() const
+            {
+                return int(atlases.size());
+            }
+
+            Image* getAtlas(int index) const
+            {
+                return atlases[index];
+            }
+    };
+}
+
+#endif
\ No newline at end of file
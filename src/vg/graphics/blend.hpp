@@ -1,180 +1,343 @@
-#ifndef VG_GRAPHICS_BLEND_HPP
-#define VG_GRAPHICS_BLEND_HPP
-
-#include <cmath>
-#include <algorithm>
-#include "color.hpp"
-
-namespace vg
-{
-    enum BlendMode
-    {
-        BlendCopy,
-        BlendPreserve,
-        BlendMerge,
-        BlendAdd,
-        BlendSubtract,
-        BlendScreen,
-        BlendMultiply,
-        BlendLighten,
-        BlendDarken,
-        BlendDifference,
-    };
-
-    struct CopyBlender
-    {
-        Color operator()(Color source, Color dest, ColorChannel opacity) const
-        {
-            return source;
-        }
-    };
-
-    struct PreserveBlender
-    {
-        Color operator()(Color source, Color dest, ColorChannel opacity) const
-        {
-            int sourceAlpha = source[AlphaChannel] * opacity / 255;
-
-            Color result;
-            result[RedChannel] = (sourceAlpha * (source[RedChannel] - dest[RedChannel])) / 255 + dest[RedChannel];
-            result[GreenChannel] = (sourceAlpha * (source[GreenChannel] - dest[GreenChannel])) / 255 + dest[GreenChannel];
-            result[BlueChannel] = (sourceAlpha * (source[BlueChannel] - dest[BlueChannel])) / 255 + dest[BlueChannel];
-            result[AlphaChannel] = dest[AlphaChannel];
-
-            return result;
-        }
-    };
-
-    struct MergeBlender
-    {
-        Color operator()(Color source, Color dest, ColorChannel opacity) const
-        {
-            int sourceAlpha = source[AlphaChannel] * opacity / 255;
-            int finalAlpha = sourceAlpha + ((255 - sourceAlpha) * dest[AlphaChannel]) / 255;
-            sourceAlpha = (finalAlpha == 0) ? 0 : sourceAlpha * 255 / finalAlpha;
-
-            Color result;
-            result[RedChannel] = (source[RedChannel] * sourceAlpha + dest[RedChannel] * (255 - sourceAlpha)) / 255;
-            result[GreenChannel] = (source[GreenChannel] * sourceAlpha + dest[GreenChannel] * (255 - sourceAlpha)) / 255;
-            result[BlueChannel] = (source[BlueChannel] * sourceAlpha + dest[BlueChannel] * (255 - sourceAlpha)) / 255;
-            result[AlphaChannel] = finalAlpha;
-
-            return result;
-        }
-    };
-
-    struct AddBlender
-    {
-        Color operator()(Color source, Color dest, ColorChannel opacity) const
-        {
-            int sourceAlpha = source[AlphaChannel] * opacity / 255;
-
-            Color result;
-            result[RedChannel] = std::min((sourceAlpha * source[RedChannel]) / 255 + dest[RedChannel], 255);
-            result[GreenChannel] = std::min((sourceAlpha * source[GreenChannel]) / 255 + dest[GreenChannel], 255);
-            result[BlueChannel] = std::min((sourceAlpha * source[BlueChannel]) / 255 + dest[BlueChannel], 255);
-            result[AlphaChannel] = dest[AlphaChannel];
-
-            return result;
-        }
-    };
-
-    struct SubtractBlender
-    {
-        Color operator()(Color source, Color dest, ColorChannel opacity) const
-        {
-            int sourceAlpha = source[AlphaChannel] * opacity / 255;
-
-            Color result;
-            result[RedChannel] = std::max((sourceAlpha * -source[RedChannel]) / 255 + dest[RedChannel], 0);
-            result[GreenChannel] = std::max((sourceAlpha * -source[GreenChannel]) / 255 + dest[GreenChannel], 0);
-            result[BlueChannel] = std::max((sourceAlpha * -source[BlueChannel]) / 255 + dest[BlueChannel], 0);
-            result[AlphaChannel] = dest[AlphaChannel];
-
-            return result;
-        }
-    };
-
-    struct ScreenBlender
-    {
-        Color operator()(Color source, Color dest, ColorChannel opacity) const
-        {
-            int sourceAlpha = source[AlphaChannel] * opacity / 255;
-
-            Color result;
-            result[RedChannel] = (sourceAlpha * (255 - (((255 - source[RedChannel]) * (255 - dest[RedChannel])) / 255) - dest[RedChannel])) / 255 + dest[RedChannel];
-            result[GreenChannel] = (sourceAlpha * (255 - (((255 - source[GreenChannel]) * (255 - dest[GreenChannel])) / 255) - dest[GreenChannel])) / 255 + dest[GreenChannel];
-            result[BlueChannel] = (sourceAlpha * (255 - (((255 - source[BlueChannel]) * (255 - dest[BlueChannel])) / 255) - dest[BlueChannel])) / 255 + dest[BlueChannel];
-            result[AlphaChannel] = dest[AlphaChannel];
-
-            return result;
-        }
-    };
-
-    struct MultiplyBlender
-    {
-        Color operator()(Color source, Color dest, ColorChannel opacity) const
-        {
-            int sourceAlpha = source[AlphaChannel] * opacity / 255;
-
-            Color result;
-            result[RedChannel] = (sourceAlpha * ((source[RedChannel] * dest[RedChannel]) / 256 - dest[RedChannel])) / 255 + dest[RedChannel];
-            result[GreenChannel] = (sourceAlpha * ((source[GreenChannel] * dest[GreenChannel]) / 256 - dest[GreenChannel])) / 255 + dest[GreenChannel];
-            result[BlueChannel] = (sourceAlpha * ((source[BlueChannel] * dest[BlueChannel]) / 256 - dest[BlueChannel])) / 255 + dest[BlueChannel];
-            result[AlphaChannel] = dest[AlphaChannel];
-
-            return result;
-        }
-    };
-
-    struct LightenBlender
-    {
-        Color operator()(Color source, Color dest, ColorChannel opacity) const
-        {
-            int sourceAlpha = source[AlphaChannel] * opacity / 255;
-
-            Color result;
-            result[RedChannel] = (sourceAlpha * (std::max(source[RedChannel], dest[RedChannel]) - dest[RedChannel])) / 255 + dest[RedChannel];
-            result[GreenChannel] = (sourceAlpha * (std::max(source[GreenChannel], dest[GreenChannel]) - dest[GreenChannel])) / 255 + dest[GreenChannel];
-            result[BlueChannel] = (sourceAlpha * (std::max(source[BlueChannel], dest[BlueChannel]) - dest[BlueChannel])) / 255 + dest[BlueChannel];
-            result[AlphaChannel] = dest[AlphaChannel];
-
-            return result;
-        }
-    };
-
-    struct DarkenBlender
-    {
-        Color operator()(Color source, Color dest, ColorChannel opacity) const
-        {
-            int sourceAlpha = source[AlphaChannel] * opacity / 255;
-
-            Color result;
-            result[RedChannel] = (sourceAlpha * (std::min(source[RedChannel], dest[RedChannel]) - dest[RedChannel])) / 255 + dest[RedChannel];
-            result[GreenChannel] = (sourceAlpha * (std::min(source[GreenChannel], dest[GreenChannel]) - dest[GreenChannel])) / 255 + dest[GreenChannel];
-            result[BlueChannel] = (sourceAlpha * (std::min(source[BlueChannel], dest[BlueChannel]) - dest[BlueChannel])) / 255 + dest[BlueChannel];
-            result[AlphaChannel] = dest[AlphaChannel];
-
-            return result;
-        }
-    };
-
-
-    struct DifferenceBlender
-    {
-        Color operator()(Color source, Color dest, ColorChannel opacity) const
-        {
-            int sourceAlpha = source[AlphaChannel] * opacity / 255;
-
-            Color result;
-            result[RedChannel] = (sourceAlpha * (std::abs(source[RedChannel] - dest[RedChannel]) - dest[RedChannel])) / 255 + dest[RedChannel];
-            result[GreenChannel] = (sourceAlpha * (std::abs(source[GreenChannel] - dest[GreenChannel]) - dest[GreenChannel])) / 255 + dest[GreenChannel];
-            result[BlueChannel] = (sourceAlpha * (std::abs(source[BlueChannel] - dest[BlueChannel]) - dest[BlueChannel])) / 255 + dest[BlueChannel];
-            result[AlphaChannel] = dest[AlphaChannel];
-
-            return result;
-        }
-    };
-}
-
+#ifndef VG_GRAPHICS_BLEND_HPP
+#define VG_GRAPHICS_BLEND_HPP
+
+#include <cmath>
+#include <algorithm>
+#include "color.hpp"
+
+namespace vg
+{
+    enum BlendMode
+    {
+        BlendCopy,
+        BlendPreserve,
+        BlendMerge,
+        BlendAdd,
+        BlendSubtract,
+        BlendScreen,
+        BlendMultiply,
+        BlendLighten,
+        BlendDarken,
+        BlendDifference,
+        BlendModeCount
+    };
+
+    // How an Image's opacity affects blending.
+    enum OpacityClass
+    {
+        OpacityZero,
+        OpacityPartial,
+        OpacityFull,
+    };
+
+    // What a run of source pixels contains in its alpha channel.
+    enum AlphaClass
+    {
+        AlphaTransparent, // Every pixel has alpha 0.
+        AlphaOpaque,      // Every pixel has alpha 255.
+        AlphaBinary,      // A mix of alpha 0 and alpha 255 only.
+        AlphaVariable,    // Anything else.
+    };
+
+    inline OpacityClass classifyOpacity(ColorChannel opacity)
+    {
+        return opacity == 0 ? OpacityZero : opacity == 255 ? OpacityFull : OpacityPartial;
+    }
+
+    // Describes what a Blender does at the extremes of the effective source alpha
+    // (source alpha * opacity / 255), so draws can skip or copy whole spans.
+    // The defaults promise nothing, which is always safe for custom Blenders.
+    template<typename BlendFunction> struct BlendTraits
+    {
+        enum
+        {
+            // An effective alpha of 0 leaves the dest pixel untouched.
+            SkipsTransparent = false,
+            // An opaque source at full opacity replaces the dest pixel outright.
+            CopiesOpaque = false,
+        };
+    };
+
+    struct CopyBlender
+    {
+        Color operator()(Color source, Color dest, ColorChannel opacity) const
+        {
+            return source;
+        }
+    };
+
+    struct PreserveBlender
+    {
+        Color operator()(Color source, Color dest, ColorChannel opacity) const
+        {
+            int sourceAlpha = source[AlphaChannel] * opacity / 255;
+
+            Color result;
+            result[RedChannel] = (sourceAlpha * (source[RedChannel] - dest[RedChannel])) / 255 + dest[RedChannel];
+            result[GreenChannel] = (sourceAlpha * (source[GreenChannel] - dest[GreenChannel])) / 255 + dest[GreenChannel];
+            result[BlueChannel] = (sourceAlpha * (source[BlueChannel] - dest[BlueChannel])) / 255 + dest[BlueChannel];
+            result[AlphaChannel] = dest[AlphaChannel];
+
+            return result;
+        }
+    };
+
+    struct MergeBlender
+    {
+        Color operator()(Color source, Color dest, ColorChannel opacity) const
+        {
+            int sourceAlpha = source[AlphaChannel] * opacity / 255;
+            int finalAlpha = sourceAlpha + ((255 - sourceAlpha) * dest[AlphaChannel]) / 255;
+            sourceAlpha = (finalAlpha == 0) ? 0 : sourceAlpha * 255 / finalAlpha;
+
+            Color result;
+            result[RedChannel] = (source[RedChannel] * sourceAlpha + dest[RedChannel] * (255 - sourceAlpha)) / 255;
+            result[GreenChannel] = (source[GreenChannel] * sourceAlpha + dest[GreenChannel] * (255 - sourceAlpha)) / 255;
+            result[BlueChannel] = (source[BlueChannel] * sourceAlpha + dest[BlueChannel] * (255 - sourceAlpha)) / 255;
+            result[AlphaChannel] = finalAlpha;
+
+            return result;
+        }
+    };
+
+    struct AddBlender
+    {
+        Color operator()(Color source, Color dest, ColorChannel opacity) const
+        {
+            int sourceAlpha = source[AlphaChannel] * opacity / 255;
+
+            Color result;
+            result[RedChannel] = std::min((sourceAlpha * source[RedChannel]) / 255 + dest[RedChannel], 255);
+            result[GreenChannel] = std::min((sourceAlpha * source[GreenChannel]) / 255 + dest[GreenChannel], 255);
+            result[BlueChannel] = std::min((sourceAlpha * source[BlueChannel]) / 255 + dest[BlueChannel], 255);
+            result[AlphaChannel] = dest[AlphaChannel];
+
+            return result;
+        }
+    };
+
+    struct SubtractBlender
+    {
+        Color operator()(Color source, Color dest, ColorChannel opacity) const
+        {
+            int sourceAlpha = source[AlphaChannel] * opacity / 255;
+
+            Color result;
+            result[RedChannel] = std::max((sourceAlpha * -source[RedChannel]) / 255 + dest[RedChannel], 0);
+            result[GreenChannel] = std::max((sourceAlpha * -source[GreenChannel]) / 255 + dest[GreenChannel], 0);
+            result[BlueChannel] = std::max((sourceAlpha * -source[BlueChannel]) / 255 + dest[BlueChannel], 0);
+            result[AlphaChannel] = dest[AlphaChannel];
+
+            return result;
+        }
+    };
+
+    struct ScreenBlender
+    {
+        Color operator()(Color source, Color dest, ColorChannel opacity) const
+        {
+            int sourceAlpha = source[AlphaChannel] * opacity / 255;
+
+            Color result;
+            result[RedChannel] = (sourceAlpha * (255 - (((255 - source[RedChannel]) * (255 - dest[RedChannel])) / 255) - dest[RedChannel])) / 255 + dest[RedChannel];
+            result[GreenChannel] = (sourceAlpha * (255 - (((255 - source[GreenChannel]) * (255 - dest[GreenChannel])) / 255) - dest[GreenChannel])) / 255 + dest[GreenChannel];
+            result[BlueChannel] = (sourceAlpha * (255 - (((255 - source[BlueChannel]) * (255 - dest[BlueChannel])) / 255) - dest[BlueChannel])) / 255 + dest[BlueChannel];
+            result[AlphaChannel] = dest[AlphaChannel];
+
+            return result;
+        }
+    };
+
+    struct MultiplyBlender
+    {
+        Color operator()(Color source, Color dest, ColorChannel opacity) const
+        {
+            int sourceAlpha = source[AlphaChannel] * opacity / 255;
+
+            Color result;
+            result[RedChannel] = (sourceAlpha * ((source[RedChannel] * dest[RedChannel]) / 256 - dest[RedChannel])) / 255 + dest[RedChannel];
+            result[GreenChannel] = (sourceAlpha * ((source[GreenChannel] * dest[GreenChannel]) / 256 - dest[GreenChannel])) / 255 + dest[GreenChannel];
+            result[BlueChannel] = (sourceAlpha * ((source[BlueChannel] * dest[BlueChannel]) / 256 - dest[BlueChannel])) / 255 + dest[BlueChannel];
+            result[AlphaChannel] = dest[AlphaChannel];
+
+            return result;
+        }
+    };
+
+    struct LightenBlender
+    {
+        Color operator()(Color source, Color dest, ColorChannel opacity) const
+        {
+            int sourceAlpha = source[AlphaChannel] * opacity / 255;
+
+            Color result;
+            result[RedChannel] = (sourceAlpha * (std::max(source[RedChannel], dest[RedChannel]) - dest[RedChannel])) / 255 + dest[RedChannel];
+            result[GreenChannel] = (sourceAlpha * (std::max(source[GreenChannel], dest[GreenChannel]) - dest[GreenChannel])) / 255 + dest[GreenChannel];
+            result[BlueChannel] = (sourceAlpha * (std::max(source[BlueChannel], dest[BlueChannel]) - dest[BlueChannel])) / 255 + dest[BlueChannel];
+            result[AlphaChannel] = dest[AlphaChannel];
+
+            return result;
+        }
+    };
+
+    struct DarkenBlender
+    {
+        Color operator()(Color source, Color dest, ColorChannel opacity) const
+        {
+            int sourceAlpha = source[AlphaChannel] * opacity / 255;
+
+            Color result;
+            result[RedChannel] = (sourceAlpha * (std::min(source[RedChannel], dest[RedChannel]) - dest[RedChannel])) / 255 + dest[RedChannel];
+            result[GreenChannel] = (sourceAlpha * (std::min(source[GreenChannel], dest[GreenChannel]) - dest[GreenChannel])) / 255 + dest[GreenChannel];
+            result[BlueChannel] = (sourceAlpha * (std::min(source[BlueChannel], dest[BlueChannel]) - dest[BlueChannel])) / 255 + dest[BlueChannel];
+            result[AlphaChannel] = dest[AlphaChannel];
+
+            return result;
+        }
+    };
+
+
+    struct DifferenceBlender
+    {
+        Color operator()(Color source, Color dest, ColorChannel opacity) const
+        {
+            int sourceAlpha = source[AlphaChannel] * opacity / 255;
+
+            Color result;
+            result[RedChannel] = (sourceAlpha * (std::abs(source[RedChannel] - dest[RedChannel]) - dest[RedChannel])) / 255 + dest[RedChannel];
+            result[GreenChannel] = (sourceAlpha * (std::abs(source[GreenChannel] - dest[GreenChannel]) - dest[GreenChannel])) / 255 + dest[GreenChannel];
+            result[BlueChannel] = (sourceAlpha * (std::abs(source[BlueChannel] - dest[BlueChannel]) - dest[BlueChannel])) / 255 + dest[BlueChannel];
+            result[AlphaChannel] = dest[AlphaChannel];
+
+            return result;
+        }
+    };
+
+    // Blenders for Images stored with premultiplied alpha (see Image::premultiply).
+    // The opacity scales every channel of the source, alpha included, and then
+    // composition is only multiplies and adds, with no per-pixel division.
+    // Results are only meaningful if source and dest are both premultiplied.
+
+    // Porter-Duff "over": source + dest * (1 - source alpha).
+    struct PremultipliedMergeBlender
+    {
+        Color operator()(Color source, Color dest, ColorChannel opacity) const
+        {
+            int sourceAlpha = source[AlphaChannel] * opacity / 255;
+
+            Color result;
+            result[RedChannel] = std::min(source[RedChannel] * opacity / 255 + dest[RedChannel] * (255 - sourceAlpha) / 255, 255);
+            result[GreenChannel] = std::min(source[GreenChannel] * opacity / 255 + dest[GreenChannel] * (255 - sourceAlpha) / 255, 255);
+            result[BlueChannel] = std::min(source[BlueChannel] * opacity / 255 + dest[BlueChannel] * (255 - sourceAlpha) / 255, 255);
+            result[AlphaChannel] = std::min(sourceAlpha + dest[AlphaChannel] * (255 - sourceAlpha) / 255, 255);
+
+            return result;
+        }
+    };
+
+    // Porter-Duff "plus": source + dest, saturated.
+    struct PremultipliedAddBlender
+    {
+        Color operator()(Color source, Color dest, ColorChannel opacity) const
+        {
+            Color result;
+            result[RedChannel] = std::min(source[RedChannel] * opacity / 255 + dest[RedChannel], 255);
+            result[GreenChannel] = std::min(source[GreenChannel] * opacity / 255 + dest[GreenChannel], 255);
+            result[BlueChannel] = std::min(source[BlueChannel] * opacity / 255 + dest[BlueChannel], 255);
+            result[AlphaChannel] = std::min(source[AlphaChannel] * opacity / 255 + dest[AlphaChannel], 255);
+
+            return result;
+        }
+    };
+
+    // source + dest - source * dest, which never leaves 0..255.
+    struct PremultipliedScreenBlender
+    {
+        Color operator()(Color source, Color dest, ColorChannel opacity) const
+        {
+            int red = source[RedChannel] * opacity / 255;
+            int green = source[GreenChannel] * opacity / 255;
+            int blue = source[BlueChannel] * opacity / 255;
+            int alpha = source[AlphaChannel] * opacity / 255;
+
+            Color result;
+            result[RedChannel] = red + dest[RedChannel] - red * dest[RedChannel] / 255;
+            result[GreenChannel] = green + dest[GreenChannel] - green * dest[GreenChannel] / 255;
+            result[BlueChannel] = blue + dest[BlueChannel] - blue * dest[BlueChannel] / 255;
+            result[AlphaChannel] = alpha + dest[AlphaChannel] - alpha * dest[AlphaChannel] / 255;
+
+            return result;
+        }
+    };
+
+    template<> struct BlendTraits<CopyBlender>
+    {
+        enum { SkipsTransparent = false, CopiesOpaque = true };
+    };
+
+    template<> struct BlendTraits<MergeBlender>
+    {
+        enum { SkipsTransparent = true, CopiesOpaque = true };
+    };
+
+    // The rest keep the dest alpha, so they never copy outright.
+    template<> struct BlendTraits<PreserveBlender>
+    {
+        enum { SkipsTransparent = true, CopiesOpaque = false };
+    };
+
+    template<> struct BlendTraits<AddBlender>
+    {
+        enum { SkipsTransparent = true, CopiesOpaque = false };
+    };
+
+    template<> struct BlendTraits<SubtractBlender>
+    {
+        enum { SkipsTransparent = true, CopiesOpaque = false };
+    };
+
+    template<> struct BlendTraits<ScreenBlender>
+    {
+        enum { SkipsTransparent = true, CopiesOpaque = false };
+    };
+
+    template<> struct BlendTraits<MultiplyBlender>
+    {
+        enum { SkipsTransparent = true, CopiesOpaque = false };
+    };
+
+    template<> struct BlendTraits<LightenBlender>
+    {
+        enum { SkipsTransparent = true, CopiesOpaque = false };
+    };
+
+    template<> struct BlendTraits<DarkenBlender>
+    {
+        enum { SkipsTransparent = true, CopiesOpaque = false };
+    };
+
+    template<> struct BlendTraits<DifferenceBlender>
+    {
+        enum { SkipsTransparent = true, CopiesOpaque = false };
+    };
+
+    // A premultiplied source with alpha 0 can still have colour, like additive
+    // light, which these add to the dest, so they can't skip transparent pixels.
+    // "Over" an opaque source is just the source.
+    template<> struct BlendTraits<PremultipliedMergeBlender>
+    {
+        enum { SkipsTransparent = false, CopiesOpaque = true };
+    };
+
+    template<> struct BlendTraits<PremultipliedAddBlender>
+    {
+        enum { SkipsTransparent = false, CopiesOpaque = false };
+    };
+
+    template<> struct BlendTraits<PremultipliedScreenBlender>
+    {
+        enum { SkipsTransparent = false, CopiesOpaque = false };
+    };
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,187 @@
+#ifndef VG_GRAPHICS_DISPATCH_HPP
+#define VG_GRAPHICS_DISPATCH_HPP
+
+#include "blend.hpp"
+#include "color.hpp"
+#include "image.hpp"
+#include "transform.hpp"
+
+namespace vg
+{
+    // The templated Image operations, instantiated for one Blender.
+    // Lets code that only knows a BlendMode at runtime (like scripts) pick
+    // the blender once per call, rather than switching on it for every pixel.
+    struct BlendOperations
+    {
+        void (*rect)(Image* image, int x, int y, int x2, int y2, Color color);
+        void (*rectFill)(Image* image, int x, int y, int x2, int y2, Color color);
+        void (*line)(Image* image, int x, int y, int x2, int y2, Color color);
+        void (*ellipse)(Image* image, int cx, int cy, int radiusX, int radiusY, Color color);
+        void (*ellipseFill)(Image* image, int cx, int cy, int radiusX, int radiusY, Color color);
+        void (*polygonFill)(Image* image, const int* points, int pointCount, Color color);
+        void (*triangleFill)(Image* image, int x, int y, int x2, int y2, int x3, int y3, Color color);
+        void (*draw)(Image* source, int x, int y, Image* dest);
+        void (*drawRegion)(Image* source, int sourceX, int sourceY, int sourceX2, int sourceY2,
+            int destX, int destY, Image* dest);
+        void (*scaleDraw)(Image* source, int destX, int destY, double scaleX, double scaleY, Image* dest);
+        void (*scaleDrawRegion)(Image* source, int sourceX, int sourceY, int sourceX2, int sourceY2,
+            int destX, int destY, double scaleX, double scaleY, Image* dest);
+        void (*rotateScaleBlitRegion)(Image* source, int sourceX, int sourceY, int sourceX2, int sourceY2,
+            int destX, int destY, double angle, double scale, Image* dest);
+        void (*transformDrawRegion)(Image* source, int sourceX, int sourceY, int sourceX2, int sourceY2,
+            const Transform2D& transform, Image* dest);
+
+        // For SpriteBatch: a draw at a given opacity, and the rows of one already
+        // clipped to dest, at an opacity already classified.
+        void (*drawRegionAtOpacity)(Image* source, int sourceX, int sourceY, int sourceX2, int sourceY2,
+            int destX, int destY, Image* dest, ColorChannel opacity);
+        void (*blendRows)(const Image* source, int sourceX, int sourceY, int sourceX2, int sourceY2,
+            int destX, int destY, Image* dest, ColorChannel opacity, OpacityClass opacityClass);
+        // Whether the Blender leaves dest alone where the source is transparent.
+        bool skipsTransparent;
+    };
+
+    template<typename BlendFunction> struct BlendInstantiation
+    {
+        static const BlendOperations Operations;
+
+        static void rect(Image* image, int x, int y, int x2, int y2, Color color)
+        {
+            image->rect(x, y, x2, y2, color, BlendFunction());
+        }
+
+        static void rectFill(Image* image, int x, int y, int x2, int y2, Color color)
+        {
+            image->rectFill(x, y, x2, y2, color, BlendFunction());
+        }
+
+        static void line(Image* image, int x, int y, int x2, int y2, Color color)
+        {
+            image->line(x, y, x2, y2, color, BlendFunction());
+        }
+
+        static void ellipse(Image* image, int cx, int cy, int radiusX, int radiusY, Color color)
+        {
+            image->ellipse(cx, cy, radiusX, radiusY, color, BlendFunction());
+        }
+
+        static void ellipseFill(Image* image, int cx, int cy, int radiusX, int radiusY, Color color)
+        {
+            image->ellipseFill(cx, cy, radiusX, radiusY, color, BlendFunction());
+        }
+
+        static void polygonFill(Image* image, const int* points, int pointCount, Color color)
+        {
+            image->polygonFill(points, pointCount, color, BlendFunction());
+        }
+
+        static void triangleFill(Image* image, int x, int y, int x2, int y2, int x3, int y3, Color color)
+        {
+            image->triangleFill(x, y, x2, y2, x3, y3, color, BlendFunction());
+        }
+
+        static void draw(Image* source, int x, int y, Image* dest)
+        {
+            source->draw(x, y, dest, BlendFunction());
+        }
+
+        static void drawRegion(Image* source, int sourceX, int sourceY, int sourceX2, int sourceY2,
+            int destX, int destY, Image* dest)
+        {
+            source->drawRegion(sourceX, sourceY, sourceX2, sourceY2, destX, destY, dest, BlendFunction());
+        }
+
+        static void scaleDraw(Image* source, int destX, int destY, double scaleX, double scaleY, Image* dest)
+        {
+            source->scaleDraw(destX, destY, scaleX, scaleY, dest, BlendFunction());
+        }
+
+        static void scaleDrawRegion(Image* source, int sourceX, int sourceY, int sourceX2, int sourceY2,
+            int destX, int destY, double scaleX, double scaleY, Image* dest)
+        {
+            source->scaleDrawRegion(sourceX, sourceY, sourceX2, sourceY2, destX, destY, scaleX, scaleY, dest, BlendFunction());
+        }
+
+        static void rotateScaleBlitRegion(Image* source, int sourceX, int sourceY, int sourceX2, int sourceY2,
+            int destX, int destY, double angle, double scale, Image* dest)
+        {
+            source->rotateScaleBlitRegion(sourceX, sourceY, sourceX2, sourceY2, destX, destY, angle, scale, dest, BlendFunction());
+        }
+
+        static void transformDrawRegion(Image* source, int sourceX, int sourceY, int sourceX2, int sourceY2,
+            const Transform2D& transform, Image* dest)
+        {
+            source->transformDrawRegion(sourceX, sourceY, sourceX2, sourceY2, transform, dest, BlendFunction());
+        }
+
+        static void drawRegionAtOpacity(Image* source, int sourceX, int sourceY, int sourceX2, int sourceY2,
+            int destX, int destY, Image* dest, ColorChannel opacity)
+        {
+            source->drawRegionAtOpacity(sourceX, sourceY, sourceX2, sourceY2, destX, destY, dest, opacity, BlendFunction());
+        }
+
+        static void blendRows(const Image* source, int sourceX, int sourceY, int sourceX2, int sourceY2,
+            int destX, int destY, Image* dest, ColorChannel opacity, OpacityClass opacityClass)
+        {
+            switch(opacityClass)
+            {
+                case OpacityZero:
+                    source->blendRows<OpacityZero>(sourceX, sourceY, sourceX2, sourceY2, destX, destY, dest, opacity, BlendFunction());
+                    break;
+                case OpacityFull:
+                    source->blendRows<OpacityFull>(sourceX, sourceY, sourceX2, sourceY2, destX, destY, dest, opacity, BlendFunction());
+                    break;
+                default:
+                    source->blendRows<OpacityPartial>(sourceX, sourceY, sourceX2, sourceY2, destX, destY, dest, opacity, BlendFunction());
+                    break;
+            }
+        }
+    };
+
+    // Only constants and function addresses, so this is filled in at compile time.
+    template<typename BlendFunction> const BlendOperations BlendInstantiation<BlendFunction>::Operations = {
+        &BlendInstantiation<BlendFunction>::rect,
+        &BlendInstantiation<BlendFunction>::rectFill,
+        &BlendInstantiation<BlendFunction>::line,
+        &BlendInstantiation<BlendFunction>::ellipse,
+        &BlendInstantiation<BlendFunction>::ellipseFill,
+        &BlendInstantiation<BlendFunction>::polygonFill,
+        &BlendInstantiation<BlendFunction>::triangleFill,
+        &BlendInstantiation<BlendFunction>::draw,
+        &BlendInstantiation<BlendFunction>::drawRegion,
+        &BlendInstantiation<BlendFunction>::scaleDraw,
+        &BlendInstantiation<BlendFunction>::scaleDrawRegion,
+        &BlendInstantiation<BlendFunction>::rotateScaleBlitRegion,
+        &BlendInstantiation<BlendFunction>::transformDrawRegion,
+        &BlendInstantiation<BlendFunction>::drawRegionAtOpacity,
+        &BlendInstantiation<BlendFunction>::blendRows,
+        BlendTraits<BlendFunction>::SkipsTransparent != 0,
+    };
+
+    // Returns the operations for a BlendMode, or null if the mode isn't valid.
+    inline const BlendOperations* getBlendOperations(BlendMode mode)
+    {
+        // Indexed by BlendMode, so keep this in the same order as the enum.
+        static const BlendOperations* const Table[] = {
+            &BlendInstantiation<CopyBlender>::Operations,
+            &BlendInstantiation<PreserveBlender>::Operations,
+            &BlendInstantiation<MergeBlender>::Operations,
+            &BlendInstantiation<AddBlender>::Operations,
+            &BlendInstantiation<SubtractBlender>::Operations,
+            &BlendInstantiation<ScreenBlender>::Operations,
+            &BlendInstantiation<MultiplyBlender>::Operations,
+            &BlendInstantiation<LightenBlender>::Operations,
+            &BlendInstantiation<DarkenBlender>::Operations,
+            &BlendInstantiation<DifferenceBlender>::Operations,
+        };
+        static_assert(sizeof(Table) / sizeof(*Table) == BlendModeCount, "Blend dispatch table doesn't cover every BlendMode.");
+
+        if(mode < 0 || mode >= BlendModeCount)
+        {
+            return 0;
+        }
+        return Table[mode];
+    }
+}
+
+#endif
\ No newline at end of file
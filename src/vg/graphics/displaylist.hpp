@@ -0,0 +1,402 @@
+#ifndef VG_GRAPHICS_DISPLAYLIST_HPP
+#define VG_GRAPHICS_DISPLAYLIST_HPP
+
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include "blend.hpp"
+#include "color.hpp"
+#include "image.hpp"
+
+namespace vg
+{
+    // Records draw calls against a target Image, and rasterizes them all at once
+    // on flush. The target is cut into tiles, each command goes into the bins of
+    // the tiles it touches, and each tile's commands are drawn in the order they
+    // were recorded. A tile's pixels stay in cache for all of its commands, and
+    // with a worker pool on the target (Image::setWorkerPool) the tiles are
+    // drawn in parallel.
+    //
+    // The result is identical to drawing each call straight onto the target.
+    // Each command keeps the target's clipping region and opacity from the time
+    // it was recorded, as does the opacity of each source image. Source pixels
+    // are read at flush time, so they mustn't change until then.
+    class DisplayList
+    {
+        public:
+            enum { TileSize = 64 };
+
+        private:
+            class Command
+            {
+                public:
+                    // The target area the command can touch, inside its clipping region.
+                    int x, y, x2, y2;
+                    int clipX, clipY, clipX2, clipY2;
+                    ColorChannel opacity;
+
+                    virtual ~Command()
+                    {
+                    }
+
+                    // Called once before tiles are drawn, on the flushing thread.
+                    virtual void prepare()
+                    {
+                    }
+
+                    // Draws the command onto a tile, whose top-left pixel is at
+                    // tileX, tileY on the target.
+                    virtual void execute(Image* tile, int tileX, int tileY) = 0;
+            };
+
+            template<typename BlendFunction> class RectCommand : public Command
+            {
+                public:
+                    int rectX, rectY, rectX2, rectY2;
+                    Color color;
+                    BlendFunction f;
+                    bool filled;
+
+                    void execute(Image* tile, int tileX, int tileY)
+                    {
+                        if(filled)
+                        {
+                            tile->rectFill(rectX - tileX, rectY - tileY, rectX2 - tileX, rectY2 - tileY, color, f);
+                        }
+                        else
+                        {
+                            tile->rect(rectX - tileX, rectY - tileY, rectX2 - tileX, rectY2 - tileY, color, f);
+                        }
+                    }
+            };
+
+            template<typename BlendFunction> class EllipseCommand : public Command
+            {
+                public:
+                    int cx, cy, radiusX, radiusY;
+                    Color color;
+                    BlendFunction f;
+                    bool filled;
+
+                    void execute(Image* tile, int tileX, int tileY)
+                    {
+                        if(filled)
+                        {
+                            tile->ellipseFill(cx - tileX, cy - tileY, radiusX, radiusY, color, f);
+                        }
+                        else
+                        {
+                            tile->ellipse(cx - tileX, cy - tileY, radiusX, radiusY, color, f);
+                        }
+                    }
+            };
+
+            template<typename BlendFunction> class DrawCommand : public Command
+            {
+                public:
+                    Image* source;
+                    int sourceX, sourceY, sourceX2, sourceY2;
+                    int destX, destY;
+                    double scaleX, scaleY;
+                    ColorChannel sourceOpacity;
+                    BlendFunction f;
+                    bool scaled;
+                    ScaleFilter filter;
+
+                    // Works out the alpha metadata up front, so the tiles only read it.
+                    void prepare()
+                    {
+                        source->getAlphaClass();
+                    }
+
+                    void execute(Image* tile, int tileX, int tileY)
+                    {
+                        if(scaled)
+                        {
+                            source->scaleDrawRegionAtOpacity(sourceX, sourceY, sourceX2, sourceY2, destX - tileX, destY - tileY, scaleX, scaleY, tile, sourceOpacity, f, filter);
+                        }
+                        else
+                        {
+                            source->drawRegionAtOpacity(sourceX, sourceY, sourceX2, sourceY2, destX - tileX, destY - tileY, tile, sourceOpacity, f);
+                        }
+                    }
+            };
+
+            Image* target;
+            std::vector<Command*> commands;
+
+            // The number of pixels from a to b once clamped to 0..size-1, like the draws do.
+            static int clampedLength(int a, int b, int size)
+            {
+                a = std::min(std::max(0, a), size - 1);
+                b = std::min(std::max(0, b), size - 1);
+                return std::abs(b - a) + 1;
+            }
+
+            // Fills in the target state and bounds of a command, and keeps it if it
+            // can touch anything. Takes ownership of the command.
+            void add(Command* command, int x, int y, int x2, int y2)
+            {
+                target->getClip(command->clipX, command->clipY, command->clipX2, command->clipY2);
+                command->opacity = target->getOpacity();
+                command->x = std::max(std::min(x, x2), command->clipX);
+                command->y = std::max(std::min(y, y2), command->clipY);
+                command->x2 = std::min(std::max(x, x2), command->clipX2);
+                command->y2 = std::min(std::max(y, y2), command->clipY2);
+                if(command->x > command->x2 || command->y > command->y2)
+                {
+                    delete command;
+                    return;
+                }
+                commands.push_back(command);
+            }
+
+            template<typename BlendFunction> void addRect(int x, int y, int x2, int y2, Color color, BlendFunction f, bool filled)
+            {
+                RectCommand<BlendFunction>* command = new RectCommand<BlendFunction>();
+                command->rectX = x;
+                command->rectY = y;
+                command->rectX2 = x2;
+                command->rectY2 = y2;
+                command->color = color;
+                command->f = f;
+                command->filled = filled;
+                add(command, x, y, x2, y2);
+            }
+
+            template<typename BlendFunction> void addEllipse(int cx, int cy, int radiusX, int radiusY, Color color, BlendFunction f, bool filled)
+            {
+                EllipseCommand<BlendFunction>* command = new EllipseCommand<BlendFunction>();
+                command->cx = cx;
+                command->cy = cy;
+                command->radiusX = radiusX;
+                command->radiusY = radiusY;
+                command->color = color;
+                command->f = f;
+                command->filled = filled;
+                add(command, cx - std::abs(radiusX), cy - std::abs(radiusY), cx + std::abs(radiusX), cy + std::abs(radiusY));
+            }
+
+            // Draws the commands binned to one tile, straight onto the target's pixels.
+            // The tile is an Image over those pixels with no parent, so tiles drawn at
+            // the same time don't all mark the target dirty. flush has done that already.
+            void drawTile(const std::vector<int>& bin, int tileX, int tileY, Color* data, int pitch, int width, int height)
+            {
+                int tileWidth = std::min<int>(TileSize, width - tileX);
+                int tileHeight = std::min<int>(TileSize, height - tileY);
+                Image tile(tileWidth, tileHeight, data + tileY * pitch + tileX, pitch);
+
+                for(size_t i = 0; i < bin.size(); i++)
+                {
+                    Command* command = commands[bin[i]];
+                    int clipX = std::max(command->clipX, tileX);
+                    int clipY = std::max(command->clipY, tileY);
+                    int clipX2 = std::min(command->clipX2, tileX + tileWidth - 1);
+                    int clipY2 = std::min(command->clipY2, tileY + tileHeight - 1);
+                    if(clipX <= clipX2 && clipY <= clipY2)
+                    {
+                        tile.setClip(clipX - tileX, clipY - tileY, clipX2 - tileX, clipY2 - tileY);
+                        tile.setOpacity(command->opacity);
+                        command->execute(&tile, tileX, tileY);
+                    }
+                }
+            }
+
+        public:
+            DisplayList(Image* target):
+                target(target)
+            {
+            }
+
+            ~DisplayList()
+            {
+                clear();
+            }
+
+            Image* getTarget() const
+            {
+                return target;
+            }
+
+            int getCommandCount() const
+            {
+                return int(commands.size());
+            }
+
+            // Throws away the recorded commands without drawing them.
+            void clear()
+            {
+                for(size_t i = 0; i < commands.size(); i++)
+                {
+                    delete commands[i];
+                }
+                commands.clear();
+            }
+
+            // Draws every recorded command onto the target, then clears the list.
+            void flush()
+            {
+                if(commands.empty())
+                {
+                    return;
+                }
+
+                int width = target->getWidth();
+                int height = target->getHeight();
+                int tilesX = (width + TileSize - 1) / TileSize;
+                int tilesY = (height + TileSize - 1) / TileSize;
+
+                // Bin the commands by tile. Each bin stays in recorded order.
+                // Only the areas the commands can touch get marked dirty.
+                Color* data = 0;
+                std::vector<std::vector<int> > bins(tilesX * tilesY);
+                for(size_t i = 0; i < commands.size(); i++)
+                {
+                    Command* command = commands[i];
+                    command->prepare();
+                    data = target->getRawData(command->x, command->y, command->x2, command->y2);
+                    for(int ty = command->y / TileSize; ty <= command->y2 / TileSize; ty++)
+                    {
+                        for(int tx = command->x / TileSize; tx <= command->x2 / TileSize; tx++)
+                        {
+                            bins[ty * tilesX + tx].push_back(int(i));
+                        }
+                    }
+                }
+
+                std::vector<int> tiles;
+                for(int i = 0; i < tilesX * tilesY; i++)
+                {
+                    if(!bins[i].empty())
+                    {
+                        tiles.push_back(i);
+                    }
+                }
+
+                AbstractWorkerPool* pool = target->getWorkerPool();
+                if(pool && pool->getThreadCount() > 1 && tiles.size() > 1)
+                {
+                    runTask(pool, int(tiles.size()), [&](int index)
+                    {
+                        int tile = tiles[index];
+                        this->drawTile(bins[tile], tile % tilesX * TileSize, tile / tilesX * TileSize, data, target->getPitch(), width, height);
+                    });
+                }
+                else
+                {
+                    for(size_t i = 0; i < tiles.size(); i++)
+                    {
+                        drawTile(bins[tiles[i]], tiles[i] % tilesX * TileSize, tiles[i] / tilesX * TileSize, data, target->getPitch(), width, height);
+                    }
+                }
+
+                clear();
+            }
+
+            template<typename BlendFunction> void rect(int x, int y, int x2, int y2, Color color, BlendFunction f)
+            {
+                addRect(x, y, x2, y2, color, f, false);
+            }
+
+            template<typename BlendFunction> void rectFill(int x, int y, int x2, int y2, Color color, BlendFunction f)
+            {
+                addRect(x, y, x2, y2, color, f, true);
+            }
+
+            // Lines are clipped by moving their end points, so drawing one a tile at a
+            // time wouldn't give the same pixels. They're cheap anyway, so they flush
+            // what's before them and are drawn straight onto the target.
+            template<typename BlendFunction> void line(int x, int y, int x2, int y2, Color color, BlendFunction f)
+            {
+                flush();
+                target->line(x, y, x2, y2, color, f);
+            }
+
+            template<typename BlendFunction> void ellipse(int cx, int cy, int radiusX, int radiusY, Color color, BlendFunction f)
+            {
+                addEllipse(cx, cy, radiusX, radiusY, color, f, false);
+            }
+
+            template<typename BlendFunction> void ellipseFill(int cx, int cy, int radiusX, int radiusY, Color color, BlendFunction f)
+            {
+                addEllipse(cx, cy, radiusX, radiusY, color, f, true);
+            }
+
+            template<typename BlendFunction> void draw(Image* source, int x, int y, BlendFunction f)
+            {
+                drawRegion(source, 0, 0, source->getWidth() - 1, source->getHeight() - 1, x, y, f);
+            }
+
+            template<typename BlendFunction> void drawRegion(Image* source, int sourceX, int sourceY, int sourceX2, int sourceY2,
+                int destX, int destY, BlendFunction f)
+            {
+                // Reading the target while tiles write to it won't work, so draw it now.
+                if(source->sharesPixels(target))
+                {
+                    flush();
+                    source->drawRegion(sourceX, sourceY, sourceX2, sourceY2, destX, destY, target, f);
+                    return;
+                }
+
+                DrawCommand<BlendFunction>* command = new DrawCommand<BlendFunction>();
+                command->source = source;
+                command->sourceX = sourceX;
+                command->sourceY = sourceY;
+                command->sourceX2 = sourceX2;
+                command->sourceY2 = sourceY2;
+                command->destX = destX;
+                command->destY = destY;
+                command->scaleX = 1;
+                command->scaleY = 1;
+                command->sourceOpacity = source->getOpacity();
+                command->f = f;
+                command->scaled = false;
+                command->filter = ScaleNearest;
+                add(command, destX, destY,
+                    destX + clampedLength(sourceX, sourceX2, source->getWidth()) - 1,
+                    destY + clampedLength(sourceY, sourceY2, source->getHeight()) - 1);
+            }
+
+            template<typename BlendFunction> void scaleDraw(Image* source, int destX, int destY, double scaleX, double scaleY, BlendFunction f,
+                ScaleFilter filter = ScaleNearest)
+            {
+                scaleDrawRegion(source, 0, 0, source->getWidth() - 1, source->getHeight() - 1, destX, destY, scaleX, scaleY, f, filter);
+            }
+
+            template<typename BlendFunction> void scaleDrawRegion(Image* source, int sourceX, int sourceY, int sourceX2, int sourceY2,
+                int destX, int destY, double scaleX, double scaleY, BlendFunction f, ScaleFilter filter = ScaleNearest)
+            {
+                if(source->sharesPixels(target))
+                {
+                    flush();
+                    source->scaleDrawRegion(sourceX, sourceY, sourceX2, sourceY2, destX, destY, scaleX, scaleY, target, f, filter);
+                    return;
+                }
+
+                int scaledWidth = int(scaleX * clampedLength(sourceX, sourceX2, source->getWidth()));
+                int scaledHeight = int(scaleY * clampedLength(sourceY, sourceY2, source->getHeight()));
+                if(scaledWidth <= 0 || scaledHeight <= 0)
+                {
+                    return;
+                }
+
+                DrawCommand<BlendFunction>* command = new DrawCommand<BlendFunction>();
+                command->source = source;
+                command->sourceX = sourceX;
+                command->sourceY = sourceY;
+                command->sourceX2 = sourceX2;
+                command->sourceY2 = sourceY2;
+                command->destX = destX;
+                command->destY = destY;
+                command->scaleX = scaleX;
+                command->scaleY = scaleY;
+                command->sourceOpacity = source->getOpacity();
+                command->f = f;
+                command->scaled = true;
+                command->filter = filter;
+                add(command, destX, destY, destX + scaledWidth - 1, destY + scaledHeight - 1);
+            }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,324 @@
+#ifndef VG_GRAPHICS_FILTER_HPP
+#define VG_GRAPHICS_FILTER_HPP
+
+#include <vector>
+#include <algorithm>
+#include "color.hpp"
+#include "simd.hpp"
+
+namespace vg
+{
+    // How scaled draws sample the source image.
+    enum ScaleFilter
+    {
+        ScaleNearest,  // Nearest neighbour. Sharp and cheap, but aliases when shrinking.
+        ScaleBilinear, // Blends the nearest 2x2 pixels. Meant for enlarging.
+        ScaleArea,     // Averages every pixel under each output pixel. Meant for shrinking.
+        ScaleSmooth    // Bilinear along axes that grow, area along axes that shrink.
+    };
+
+    // Filter weights for one output pixel add up to this.
+    enum { FilterWeightOne = 256 };
+
+    // The source pixels and weights behind each output pixel along one axis,
+    // worked out once per draw. Columns are shared by every row, and rows by
+    // every column, since the filters are separable. Building it again reuses
+    // the storage from last time.
+    //
+    // Channels are filtered independently, so draw premultiplied images
+    // (see Image::premultiply) to keep transparent pixels from bleeding colour.
+    class FilterTaps
+    {
+        private:
+            // Taps for output o are tapStart[o] up to tapStart[o + 1].
+            std::vector<int> tapStart;
+            std::vector<int> tapSource;
+            std::vector<int> tapWeight;
+            int maxTaps;
+
+            void addTap(int source, int weight)
+            {
+                if(weight > 0)
+                {
+                    tapSource.push_back(source);
+                    tapWeight.push_back(weight);
+                }
+            }
+
+            void finishOutput()
+            {
+                tapStart.push_back(int(tapSource.size()));
+                maxTaps = std::max(maxTaps, getTapCount(int(tapStart.size()) - 2));
+            }
+
+        public:
+            FilterTaps():
+                maxTaps(0)
+            {
+            }
+
+            // Builds taps for outputs first..last of a sourceLength pixel span scaled
+            // to scaledLength, where fixedStep is the 16.16 source step per output.
+            void build(ScaleFilter filter, int sourceLength, int scaledLength, int fixedStep, int first, int last)
+            {
+                if(filter == ScaleSmooth)
+                {
+                    filter = scaledLength >= sourceLength ? ScaleBilinear : ScaleArea;
+                }
+
+                tapStart.clear();
+                tapSource.clear();
+                tapWeight.clear();
+                maxTaps = 0;
+                tapStart.push_back(0);
+                for(int o = first; o <= last; o++)
+                {
+                    switch(filter)
+                    {
+                        case ScaleBilinear:
+                        {
+                            // Sample at the output pixel's centre, so the image doesn't shift.
+                            long long centre = (long long) o * fixedStep + fixedStep / 2 - 32768;
+                            int index = 0;
+                            int fraction = 0;
+                            if(centre > 0)
+                            {
+                                index = int(centre >> 16);
+                                fraction = int(centre & 0xFFFF) >> 8;
+                            }
+                            if(index >= sourceLength - 1)
+                            {
+                                index = sourceLength - 1;
+                                fraction = 0;
+                            }
+                            addTap(index, FilterWeightOne - fraction);
+                            addTap(index + 1, fraction);
+                            break;
+                        }
+                        case ScaleArea:
+                        {
+                            // Weight each source pixel by how much of the output pixel it covers.
+                            long long begin = (long long) o * fixedStep;
+                            long long end = begin + fixedStep;
+                            int firstTap = int(tapSource.size());
+                            int total = 0;
+                            for(long long s = begin >> 16; s < sourceLength && (s << 16) < end; s++)
+                            {
+                                long long overlap = std::min(end, (s + 1) << 16) - std::max(begin, s << 16);
+                                int weight = int((overlap * FilterWeightOne + fixedStep / 2) / fixedStep);
+                                addTap(int(s), weight);
+                                total += weight;
+                            }
+                            // Rounding can leave the weights a little off; the biggest tap makes it up.
+                            if(int(tapSource.size()) == firstTap)
+                            {
+                                addTap(std::min(int(begin >> 16), sourceLength - 1), FilterWeightOne);
+                            }
+                            else if(total != FilterWeightOne)
+                            {
+                                int biggest = int(std::max_element(tapWeight.begin() + firstTap, tapWeight.end()) - tapWeight.begin());
+                                tapWeight[biggest] += FilterWeightOne - total;
+                            }
+                            break;
+                        }
+                        default:
+                            addTap(std::min(int(((long long) o * fixedStep) >> 16), sourceLength - 1), FilterWeightOne);
+                            break;
+                    }
+                    finishOutput();
+                }
+            }
+
+            int getOutputCount() const
+            {
+                return int(tapStart.size()) - 1;
+            }
+
+            int getMaxTaps() const
+            {
+                return maxTaps;
+            }
+
+            int getTapCount(int output) const
+            {
+                return tapStart[output + 1] - tapStart[output];
+            }
+
+            const int* getSources(int output) const
+            {
+                return &tapSource[tapStart[output]];
+            }
+
+            const int* getWeights(int output) const
+            {
+                return &tapWeight[tapStart[output]];
+            }
+    };
+
+    // Filters one source row along x, into four 16-bit channels per output pixel,
+    // each holding the channel value times FilterWeightOne.
+    inline void filterRow(const Color* source, const FilterTaps& columns, unsigned short* out)
+    {
+        for(int o = 0; o < columns.getOutputCount(); o++)
+        {
+            const int* sources = columns.getSources(o);
+            const int* weights = columns.getWeights(o);
+            int sum[4] = {0, 0, 0, 0};
+            for(int k = 0; k < columns.getTapCount(o); k++)
+            {
+                const ColorChannel* pixel = (const ColorChannel*) &source[sources[k]];
+                sum[0] += pixel[0] * weights[k];
+                sum[1] += pixel[1] * weights[k];
+                sum[2] += pixel[2] * weights[k];
+                sum[3] += pixel[3] * weights[k];
+            }
+            out[o * 4] = (unsigned short) sum[0];
+            out[o * 4 + 1] = (unsigned short) sum[1];
+            out[o * 4 + 2] = (unsigned short) sum[2];
+            out[o * 4 + 3] = (unsigned short) sum[3];
+        }
+    }
+
+    namespace simd
+    {
+        // A weight scaled to 16 bits for multiplyHigh. A lone tap's full weight
+        // doesn't fit, and loses at most one 1/256th step, which rounds away.
+        inline int filterScale(int weight)
+        {
+            return std::min(weight << 8, 0xFFFF);
+        }
+
+        // Combines filtered rows along y, from pixel i for as many whole vectors
+        // as fit in count. Returns the index of the first pixel not done.
+        template<typename Isa> int combineVectors(const unsigned short* const* rows, const int* weights, int taps, Color* out, int i, int count)
+        {
+            typedef typename Isa::Vector Vector;
+            const Vector rounding = Isa::splat16(FilterWeightOne / 2);
+
+            for(; i + Isa::Width <= count; i += Isa::Width)
+            {
+                Vector low = Isa::zero();
+                Vector high = Isa::zero();
+                for(int k = 0; k < taps; k++)
+                {
+                    Vector weight = Isa::splat16(filterScale(weights[k]));
+                    low = Isa::add(low, Isa::multiplyHigh(Isa::load(rows[k] + i * 4), weight));
+                    high = Isa::add(high, Isa::multiplyHigh(Isa::load(rows[k] + i * 4 + Isa::Width * 2), weight));
+                }
+                low = Isa::divide256(Isa::add(low, rounding));
+                high = Isa::divide256(Isa::add(high, rounding));
+                Isa::store(out + i, Isa::packInOrder(low, high));
+            }
+            return i;
+        }
+    }
+
+    // Combines rows made by filterRow along y into finished pixels.
+    inline void combineRows(const unsigned short* const* rows, const int* weights, int taps, Color* out, int count)
+    {
+        int i = 0;
+#ifdef VG_AVX2
+        i = simd::combineVectors<simd::Avx2>(rows, weights, taps, out, i, count);
+#endif
+#ifdef VG_SSE2
+        i = simd::combineVectors<simd::Sse2>(rows, weights, taps, out, i, count);
+#endif
+        // Same arithmetic as the vector kernels, so every pixel comes out the same.
+        for(; i < count; i++)
+        {
+            unsigned int sum[4] = {0, 0, 0, 0};
+            for(int k = 0; k < taps; k++)
+            {
+                unsigned int weight = simd::filterScale(weights[k]);
+                for(int c = 0; c < 4; c++)
+                {
+                    sum[c] += (rows[k][i * 4 + c] * weight) >> 16;
+                }
+            }
+            ColorChannel* pixel = (ColorChannel*) &out[i];
+            for(int c = 0; c < 4; c++)
+            {
+                pixel[c] = ColorChannel((sum[c] + FilterWeightOne / 2) / FilterWeightOne);
+            }
+        }
+    }
+
+    // Keeps recently filtered source rows, so output rows that share source rows
+    // (always, when enlarging) filter each one only once, and combines them into
+    // output rows. Reset it for each draw; the buffers are kept for the next one.
+    class FilterRowCache
+    {
+        private:
+            const Color* source;
+            int pitch;
+            const FilterTaps* columns;
+            const FilterTaps* rows;
+            int slots;
+            std::vector<int> slotRow;
+            std::vector<unsigned short> buffer;
+            std::vector<const unsigned short*> tapRows;
+            std::vector<Color> output;
+
+            const unsigned short* getRow(int y)
+            {
+                int slot = y % slots;
+                unsigned short* row = &buffer[slot * columns->getOutputCount() * 4];
+                if(slotRow[slot] != y)
+                {
+                    filterRow(source + y * pitch, *columns, row);
+                    slotRow[slot] = y;
+                }
+                return row;
+            }
+
+        public:
+            FilterRowCache():
+                source(0),
+                pitch(0),
+                columns(0),
+                rows(0),
+                slots(0)
+            {
+            }
+
+            // Source is the first sampled pixel of the first row, and pitch is the
+            // distance between rows. The taps have to outlive the draw.
+            void reset(const Color* source, int pitch, const FilterTaps& columns, const FilterTaps& rows)
+            {
+                this->source = source;
+                this->pitch = pitch;
+                this->columns = &columns;
+                this->rows = &rows;
+                // One slot for each tap an output row can have.
+                slots = std::max(rows.getMaxTaps(), 1);
+                slotRow.assign(slots, -1);
+                buffer.resize(size_t(slots) * columns.getOutputCount() * 4);
+                tapRows.resize(slots);
+                output.resize(columns.getOutputCount());
+            }
+
+            // Filters output row index along both axes, returning its pixels.
+            const Color* getOutputRow(int index)
+            {
+                const int* sources = rows->getSources(index);
+                int taps = rows->getTapCount(index);
+                for(int k = 0; k < taps; k++)
+                {
+                    tapRows[k] = getRow(sources[k]);
+                }
+                combineRows(&tapRows[0], rows->getWeights(index), taps, &output[0], int(output.size()));
+                return &output[0];
+            }
+    };
+
+    // What a filtered scaled draw needs, kept by the image drawn onto, so sprites
+    // drawn onto it one after another don't allocate their own every time.
+    struct FilterScratch
+    {
+        FilterTaps columns;
+        FilterTaps rows;
+        FilterRowCache cache;
+    };
+}
+
+#endif
\ No newline at end of file
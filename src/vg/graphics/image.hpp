@@ -1,864 +1,1962 @@
-#ifndef VG_GRAPHICS_IMAGE_HPP
-#define VG_GRAPHICS_IMAGE_HPP
-
-#include <cmath>
-#include <cstring>
-#include <algorithm>
-#include "blend.hpp"
-#include "color.hpp"
-
-namespace vg
-{
-    class Image
-    {
-        private:
-            int width, height;
-            int clipX, clipY, clipX2, clipY2;
-            ColorChannel opacity;
-            Color* data;
-
-        public:
-            Image(int width, int height):
-                width(width), height(height),
-                data(new Color[width * height]),
-                opacity(255)
-            {
-                clear(ColorBlack);
-                resetClip();
-            }
-
-            Image(Image* source):
-                width(source->width), height(source->height),
-                data(new Color[source->width * source->height]),
-                opacity(source->opacity)
-            {
-                source->copyRawData(this);
-                source->getClip(clipX, clipY, clipX2, clipY2);
-            }
-
-            ~Image()
-            {
-                delete[] data;
-            }
-
-            int getWidth() const
-            {
-                return width;
-            }
-
-            int getHeight() const
-            {
-                return height;
-            }
-
-            Color* getRawData() const
-            {
-                return data;
-            }
-
-            ColorChannel getOpacity() const
-            {
-                return opacity;
-            }
-
-            void setOpacity(ColorChannel opacity)
-            {
-                this->opacity = opacity;
-            }
-
-            int getPixel(int x, int y) const
-            {
-                if(x >= 0 && x < width && y >= 0 && y < height)
-                {
-                    return data[y * width + x];
-                }
-                else
-                {
-                    return 0;
-                }
-            }
-
-            int setPixel(int x, int y, Color color)
-            {
-                if(x >= clipX && x <= clipX2 && y >= clipY && y <= clipY2)
-                {
-                    data[y * width + x] = color;
-                }
-            }
-
-            void getClip(int& x, int& y, int& x2, int& y2) const
-            {
-                x = clipX;
-                y = clipY;
-                x2 = clipX2;
-                y2 = clipY2;
-            }
-
-            void resetClip()
-            {
-                setClip(0, 0, width - 1, height - 1);
-            }
-
-            void setClip(int x, int y, int x2, int y2)
-            {
-                if(x > x2)
-                {
-                    std::swap(x, x2);
-                }
-                if(y > y2)
-                {
-                    std::swap(y, y2);
-                }
-                clipX = std::min(std::max(0, x), width - 1);
-                clipY = std::min(std::max(0, y), height - 1);
-                clipX2 = std::min(std::max(0, x2), width - 1);
-                clipY2 = std::min(std::max(0, y2), height - 1);
-            }
-
-            void copyRawData(Image* dest)
-            {
-                if(width == dest->width && height == dest->height)
-                {
-                    std::memcpy(dest->data, data, width * height * sizeof(*data));
-                }
-            }
-
-            void clear(Color color)
-            {
-                for(int i = 0; i < width * height; i++)
-                {
-                    data[i] = color;
-                }
-            }
-
-            void replaceColor(Color find, Color replacement)
-            {
-                for(int i = 0; i < width * height; i++)
-                {
-                    if(data[i] == find)
-                    {
-                        data[i] = replacement;
-                    }
-                }
-            }
-
-            void flip(bool horizontal, bool vertical)
-            {
-                if(horizontal)
-                {
-                    for(int y = 0; y < height; y++)
-                    {
-                        for(int x = 0; x < width / 2; x++)
-                        {
-                            std::swap(data[y * width + x], data[y * width + (width - x - 1)]);
-                        }
-                    }
-                }
-                if(vertical)
-                {
-                    for(int y = 0; y < height / 2; y++)
-                    {
-                        for(int x = 0; x < width; x++)
-                        {
-                            std::swap(data[y * width + x], data[(height - y - 1) * width + x]);
-                        }
-                    }
-                }
-            }
-
-            template<typename BlendFunction> void rect(int x, int y, int x2, int y2, Color color, BlendFunction f)
-            {
-                // Put the coordinates in order.
-                if(x > x2)
-                {
-                    std::swap(x, x2);
-                }
-                if(y > y2)
-                {
-                    std::swap(y, y2);
-                }
-                // Don't draw if completely outside clipping regions.
-                if(x > clipX2 || y > clipY2 || x2 < clipX || y2 < clipY)
-                {
-                    return;
-                }
-                // Keep rectangle inside clipping regions
-                if(x < clipX)
-                {
-                    x = clipX;
-                }
-                if(x2 > clipX2)
-                {
-                    x2 = clipX2;
-                }
-                if(y < clipY)
-                {
-                    y = clipY;
-                }
-                if(y2 > clipY2)
-                {
-                    y2 = clipY2;
-                }
-                // Draw the horizontal lines of a rectangle.
-                for(int i = x; i <= x2; i++)
-                {
-                    data[y * width + i] = f(color, data[y * width + i], opacity);
-                    data[y2 * width + i] = f(color, data[y2 * width + i], opacity);
-                }
-                // Draw the vertical lines of a rectangle.
-                for(int i = y; i <= y2; i++)
-                {
-                    data[i * width + x] = f(color, data[i * width + x], opacity);
-                    data[i * width + x2] = f(color, data[i * width + x2], opacity);
-                }
-            }
-
-            template<typename BlendFunction> void rectFill(int x, int y, int x2, int y2, Color color, BlendFunction f)
-            {
-                // Put the coordinates in order.
-                if(x > x2)
-                {
-                    std::swap(x, x2);
-                }
-                if(y > y2)
-                {
-                    std::swap(y, y2);
-                }
-                // Don't draw if completely outside clipping regions.
-                if(x > clipX2 || y > clipY2 || x2 < clipX || y2 < clipY)
-                {
-                    return;
-                }
-                // Keep rectangle inside clipping regions
-                if(x < clipX)
-                {
-                    x = clipX;
-                }
-                if(x2 > clipX2)
-                {
-                    x2 = clipX2;
-                }
-                if(y < clipY)
-                {
-                    y = clipY;
-                }
-                if(y2 > clipY2)
-                {
-                    y2 = clipY2;
-                }
-                // Draw a filled rectangle
-                for(int i = y; i <= y2; i++)
-                {
-                    for(int j = x; j <= x2; j++)
-                    {
-                        data[i * width + j] = f(color, data[i * width + j], opacity);
-                    }
-                }
-            }
-
-            template<typename BlendFunction> void line(int x, int y, int x2, int y2, Color color, BlendFunction f)
-            {
-                enum
-                {
-                    None = 0,
-                    Left = 1,
-                    Right = 2,
-                    Top = 4,
-                    Bottom = 8
-                };
-
-                // Now we'll clip the line using Cohen-Sutherland clipping
-                // (this source adapted from ika)
-                unsigned int c1 = None;
-                unsigned int c2 = None;
-
-                // Silly region code things to start us off
-                if(x < clipX)   c1 |= Left;
-                if(x > clipX2)  c1 |= Right;
-                if(y < clipY)   c1 |= Top;
-                if(y > clipY2)  c1 |= Bottom;
-                if(x2 < clipX)  c2 |= Left;
-                if(x2 > clipX2) c2 |= Right;
-                if(y2 < clipY)  c2 |= Top;
-                if(y2 > clipY2) c2 |= Bottom;
-
-                // Keep clipping until we either accept or reject this line.
-                while(!(c1 & c2) && (c1 | c2))
-                {
-                    if(c1)
-                    {
-                        // Clip left.
-                        if(c1 & Left)
-                        {
-                            y -= ((y - y2) * (clipX - x)) / (x2 - x + 1);
-                            x = clipX;
-                        }
-                        // Clip right.
-                        else if(c1 & Right)
-                        {
-                            y -= ((y - y2) * (x - clipX2)) / (x2 - x + 1);
-                            x = clipX2;
-                        }
-                        // Clip above.
-                        else if(c1 & Top)
-                        {
-                            x -= ((x - x2) * (clipY - y)) / (y2 - y + 1);
-                            y = clipY;
-                        }
-                        // Clip below.
-                        else
-                        {
-                            x -= ((x - x2) * (y - clipY2)) / (y2 - y + 1);
-                            y = clipY2;
-                        }
-                        // Recheck all the region codes for this side of the line.
-                        c1 = None;
-                        if(x < clipX)   c1 |= Left;
-                        if(x > clipX2)  c1 |= Right;
-                        if(y < clipY)   c1 |= Top;
-                        if(y > clipY2)  c1 |= Bottom;
-                    }
-                    else
-                    {
-                        // Clip left.
-                        if(c2 & Left)
-                        {
-                            y2 -= ((y2 - y) * (clipX - x2)) / (x - x2 + 1);
-                            x2 = clipX;
-                        }
-                        // Clip right.
-                        else if(c2 & Right)
-                        {
-                            y2 -= ((y2 - y) * (x2 - clipX2)) / (x - x2 + 1);
-                            x2 = clipX2;
-                        }
-                        // Clip above.
-                        else if(c2 & Top)
-                        {
-                            x2 -= ((x2 - x) * (clipY - y2)) / (y - y2 + 1);
-                            y2 = clipY;
-                        }
-                        // Clip below.
-                        else
-                        {
-                            x2 -= ((x2 - x) * (y2 - clipY2)) / (y - y2 + 1);
-                            y2 = clipY2;
-                        }
-                        // Recheck all the region codes for this side of the line.
-                        c2 = None;
-                        if(x2 < clipX)  c2 |= Left;
-                        if(x2 > clipX2) c2 |= Right;
-                        if(y2 < clipY)  c2 |= Top;
-                        if(y2 > clipY2) c2 |= Bottom;
-                    }
-                }
-                // Don't draw if completely outside clipping regions.
-                if(c1 & c2)
-                {
-                    return;
-                }
-                // A single pixel
-                if(x == x2 && y == y2)
-                {
-                    data[y * width + x] = f(color, data[y * width + x], opacity);
-                }
-                // Horizontal line
-                else if(y == y2)
-                {
-                    // Put the coordinates in order.
-                    if (x > x2)
-                    {
-                        std::swap(x, x2);
-                    }
-                    // Draw it.
-                    for(int i = x; i <= x2; i++)
-                    {
-                        data[y * width + i] = f(color, data[y * width + i], opacity);
-                    }
-                }
-                // Vertical line
-                else if(x == x2)
-                {
-                    // Put the coordinates in order.
-                    if (y > y2)
-                    {
-                        std::swap(y, y2);
-                    }
-                    // Draw it.
-                    for(int i = y; i <= y2; i++)
-                    {
-                        data[i * width + x] = f(color, data[i * width + x], opacity);
-                    }
-                }
-                else
-                {
-                    // Time for some Bresenham.
-                    int differenceX = std::abs(x2 - x);
-                    int differenceY = std::abs(y2 - y);
-                    int deltaX = (x > x2) ? -1 : 1;
-                    int deltaY = (y > y2) ? -1 : 1;
-
-                    int errorX, errorY;
-                    int incrementX, incrementY;
-                    int resetX, resetY;
-
-                    if(dx > dy)
-                    {
-                        errorX = 0;
-                        errorY = differenceY * 2 - differenceX;
-                        incrementX = 0;
-                        incrementY = differenceY * 2;
-                        resetX = 0;
-                        resetY = (differenceY - differenceX) * 2;
-                    }
-                    else
-                    {
-                        errorX = differenceX * 2 - differenceY;
-                        errorY = 0;
-                        incrementX = differenceX * 2;
-                        incrementY = 0;
-                        resetX = (differenceX - differenceY) * 2;
-                        resetY = 0;
-                    }
-
-                    do
-                    {
-                        if(errorX < 0)
-                        {
-                            errorX += incrementX;
-                        }
-                        else
-                        {
-                            x += deltaX;
-                            errorX += resetX;
-                        }
-
-                        if(errorY < 0)
-                        {
-                            errorY += incrementY;
-                        }
-                        else
-                        {
-                            y += deltaY;
-                            errorY += resetY;
-                        }
-                        data[y * width + x] = f(color, data[y * width + x], opacity);
-                    } while((resetX || x != x2) && (resetY || y != y2))
-                }
-            }
-
-            template<typename BlendFunction> void ellipse(int cx, int cy, int radiusX, int radiusY, Color color, BlendFunction f)
-            {
-                // Algorithm based on "A Fast Bresenham Type Algorithm For Drawing Ellipses" by John Kennedy <rkennedy@ix.netcom.com>
-                int plotX, plotY;
-
-                int lastX = -1;
-                int lastY = -1;
-                int a = 2 * radiusX * radiusX;
-                int b = 2 * radiusY * radiusY;
-                int x = radiusX;
-                int y = 0;
-                int deltaX = radiusY * radiusY * (1 - 2 * radiusX);
-                int deltaY = radiusX * radiusX;
-                int ellipseError = 0;
-                int stoppingX = b * radiusX;
-                int stoppingY = 0;
-
-                // First set of points, y' > -1
-                while(stoppingX >= stoppingY)
-                {
-                    if(lastX != x || lastY != y)
-                    {
-                        int plotY = cy - y;
-                        if(plotY >= clipY && plotY <= clipY2)
-                        {
-                            int plotX = cx - x;
-                            if(plotX >= clipX && plotX <= clipX2)
-                            {
-                                data[plotY * width + plotX] = f(color, data[plotY * width + plotX], opacity);
-                            }
-                            plotX = cx + x;
-                            if(plotX >= clipX && plotX <= clipX2)
-                            {
-                                data[plotY * width + plotX] = f(color, data[plotY * width + plotX], opacity);
-                            }
-                        }
-                        if(y)
-                        {
-                            plotY = cy + y;
-                            if(plotY >= clipY && plotY <= clipY2)
-                            {
-                                int plotX = cx - x;
-                                if(plotX >= clipX && plotX <= clipX2)
-                                {
-                                    data[plotY * width + plotX] = f(color, data[plotY * width + plotX], opacity);
-                                }
-                                plotX = cx + x;
-                                if(plotX >= clipX && plotX <= clipX2)
-                                {
-                                    data[plotY * width + plotX] = f(color, data[plotY * width + plotX], opacity);
-                                }
-                            }
-                        }
-                        lastX = x;
-                        lastY = y;
-                    }
-
-                    y++;
-                    stoppingY += a;
-                    ellipseError += deltaY;
-                    deltaY += a;
-                    if(ellipseError * 2 + deltaX > 0)
-                    {
-                        x--;
-                        stoppingX -= b;
-                        ellipseError += deltaX;
-                        deltaX += b;
-                    }
-                }
-
-                // First point set is done; start the second set of points
-                x = 0;
-                y = radiusY;
-                deltaX = radiusY * radiusY;
-                deltaY = radiusX * radiusX * (1 - radiusY * 2);
-                ellipseError = 0;
-                stoppingX = 0;
-                stoppingY = a * radiusY;
-
-                // Second set of points, y' < -1
-                while(stoppingX <= stoppingY)
-                {
-                    if(lastX != x || lastY != y)
-                    {
-                        int plotY = cy - y;
-                        if(plotY >= clipY && plotY <= clipY2)
-                        {
-                            int plotX = cx - x;
-                            if(plotX >= clipX && plotX <= clipX2)
-                            {
-                                data[plotY * width + plotX] = f(color, data[plotY * width + plotX], opacity);
-                            }
-                            if(x)
-                            {
-                                plotX = cx + x;
-                                if(plotX >= clipX && plotX <= clipX2)
-                                {
-                                    data[plotY * width + plotX] = f(color, data[plotY * width + plotX], opacity);
-                                }
-                            }
-                        }
-                        if(y)
-                        {
-                            plotY = cy + y;
-                            if(plotY >= clipY && plotY <= clipY2)
-                            {
-                                int plotX = cx - x;
-                                if(plotX >= clipX && plotX <= clipX2)
-                                {
-                                    data[plotY * width + plotX] = f(color, data[plotY * width + plotX], opacity);
-                                }
-                                if(x)
-                                {
-                                    plotX = cx + x;
-                                    if(plotX >= clipX && plotX <= clipX2)
-                                    {
-                                        data[plotY * width + plotX] = f(color, data[plotY * width + plotX], opacity);
-                                    }
-                                }
-                            }
-                        }
-                        lastX = x;
-                        lastY = y;
-                    }
-
-                    x++;
-                    ellipseError += deltaX;
-                    deltaX += b;
-                    stoppingX += b;
-                    if(ellipseError * 2 + deltaY > 0)
-                    {
-                        y--;
-                        ellipseError += deltaY;
-                        deltaY += a;
-                        stoppingY -= a;
-                    }
-                }
-            }
-
-            template<typename BlendFunction> void ellipseFill(int cx, int cy, int radiusX, int radiusY, Color color, BlendFunction f)
-            {
-                // Algorithm based on "A Fast Bresenham Type Algorithm For Drawing Ellipses" by John Kennedy <rkennedy@ix.netcom.com>
-                int lastY = -1;
-                int a = 2 * radiusX * radiusX;
-                int b = 2 * radiusY * radiusY;
-                int x = radiusX;
-                int y = 0;
-                int deltaX = radiusY * radiusY * (1 - 2 * radiusX);
-                int deltaY = radiusX * radiusX;
-                int ellipseError = 0;
-                int stoppingX = b * radiusX;
-                int stoppingY = 0;
-
-                // First set of points, y' > -1
-                while(stoppingX >= stoppingY)
-                {
-                    if(lastY != y)
-                    {
-                        int plotX = std::max(cx - x, clipX);
-                        int plotX2 = std::min(cx + x, clipX2);
-                        int plotY = cy - y;
-                        if(plotY >= clipY && plotY <= clipY2)
-                        {
-                            for(int i = plotX; i <= plotX2; i++)
-                            {
-                                data[plotY * width + i] = f(color, data[plotY * width + i], opacity);
-                            }
-                        }
-                        if(y)
-                        {
-                            plotY = cy + y;
-                            if(plotY >= clipY && plotY <= clipY2)
-                            {
-                                for(int i = plotX; i <= plotX2; i++)
-                                {
-                                    data[plotY * width + i] = f(color, data[plotY * width + i], opacity);
-                                }
-                            }
-                            lastY = y;
-                        }
-                    }
-
-                    y++;
-                    stoppingY += a;
-                    ellipseError += deltaY;
-                    deltaY += a;
-                    if(ellipseError * 2 + deltaX > 0)
-                    {
-                        x--;
-                        stoppingX -= b;
-                        ellipseError += deltaX;
-                        deltaX += b;
-                    }
-                }
-
-                // First point set is done; start the second set of points
-                x = 0;
-                y = radiusY;
-                deltaX = radiusY * radiusY;
-                deltaY = radiusX * radiusX * (1 - radiusY * 2);
-                ellipseError = 0;
-                stoppingX = 0;
-                stoppingY = a * radiusY;
-
-                // Second set of points, y' < -1
-                while(stoppingX <= stoppingY)
-                {
-                    if(lastY != y)
-                    {
-                        int plotX = std::max(cx - x, clipX);
-                        int plotX2 = std::min(cx + x, clipX2);
-                        int plotY = cy - y;
-                        if(plotY >= clipY && plotY <= clipY2)
-                        {
-                            for(int i = plotX; i <= plotX2; i++)
-                            {
-                                data[plotY * width + i] = f(color, data[plotY * width + i], opacity);
-                            }
-                        }
-                        plotY = cy + y;
-                        if(plotY >= clipY && plotY <= clipY2)
-                        {
-                            for(int i = plotX; i <= plotX2; i++)
-                            {
-                                data[plotY * width + i] = f(color, data[plotY * width + i], opacity);
-                            }
-                        }
-                        lastY = y;
-                    }
-
-                    x++;
-                    ellipseError += deltaX;
-                    deltaX += b;
-                    stoppingX += b;
-                    if(ellipseError * 2 + deltaY > 0)
-                    {
-                        y--;
-                        ellipseError += deltaY;
-                        deltaY += a;
-                        stoppingY -= a;
-                    }
-                }
-            }
-
-            template<typename BlendFunction> void draw(int x, int y, Image* dest, BlendFunction f)
-            {
-                drawRegion(0, 0, width - 1, height - 1, x, y, dest, f);
-            }
-
-        private:
-            template<typename BlendFunction> void baseDrawRegion(int sourceX, int sourceY, int sourceX2, int sourceY2,
-                    int destX, int destY, Image* dest, BlendFunction f)
-            {
-                // Ensure that the source coordinates stay inside the image.
-                sourceX = std::min(std::max(0, sourceX), width - 1);
-                sourceY = std::min(std::max(0, sourceY), height - 1);
-                sourceX2 = std::min(std::max(0, sourceX2), width - 1);
-                sourceY2 = std::min(std::max(0, sourceY2), height - 1);
-
-                // Keep source rectangle coordinates in order.
-                if (sourceX > sourceX2)
-                {
-                    std::swap(sourceX, sourceX2);
-                }
-                if (sourceY > sourceY2)
-                {
-                    std::swap(sourceY, sourceY2);
-                }
-
-                int destX2 = destX + sourceX2;
-                int destY2 = destY + sourceY2;
-
-                // Don't draw if completely outside clipping regions.
-                if(destX > dest->clipX2 || destX2 < dest->clipX || destY > dest->clipY2 || destY2 < dest->clipY)
-                {
-                    return;
-                }
-
-                // Keep sample rectangle inside clipping regions.
-                if(destX < dest->clipX)
-                {
-                    sourceX += dest->clipX - destX;
-                }
-                if(destX2 > dest->clipX2)
-                {
-                    sourceX2 -= destX2 - dest->clipX2;
-                }
-                if(destY < dest->clipY)
-                {
-                    sourceY += dest->clipY - destY;
-                }
-                if(destY2 > dest->clipY2)
-                {
-                    sourceY2 -= destY2 - dest->clipY2;
-                }
-
-                // Draw the image, pixel for pixel.
-                for(int i = sourceY; i <= sourceY2; i++)
-                {
-                    for(int j = sourceX; j <= sourceX2; j++)
-                    {
-                        int srcPixel = i * width + j;
-                        int destPixel = (i + destX) * dest->width + (j + destY);
-                        dest->data[destPixel] = f(data[srcPixel], dest->data[destPixel], opacity);
-                    }
-                }
-            }
-
-        public:
-            void drawRegion(int sourceX, int sourceY, int sourceX2, int sourceY2, int destX, int destY, Image* dest, CopyBlender f)
-            {
-                // No clipping, and drawing the full source in copy blend? Just copy it raw.
-                if(sourceX == 0 && sourceY == 0 && sourceX2 == width - 1 && sourceY2 == height - 1
-                    && dest->clipX == 0 && dest->clipY == 0 && dest->clipX2 == width - 1 && dest->clipY2 == height - 1)
-                {
-                    copyRawData(dest);
-                }
-                else
-                {
-                    baseDrawRegion(sourceX, sourceY, sourceX2, sourceY2, destX, destY, dest, f);
-                }
-            }
-
-            template<typename BlendFunction> void drawRegion(int sourceX, int sourceY, int sourceX2, int sourceY2,
-                    int destX, int destY, Image* dest, BlendFunction f)
-            {
-                baseDrawRegion(sourceX, sourceY, sourceX2, sourceY2, destX, destY, dest, f);
-            }
-
-            template<typename BlendFunction> void scaleDraw(int destX, int destY, double scaleX, double scaleY, Image* dest, BlendFunction f)
-            {
-                scaleDrawRegion(0, 0, width - 1, height - 1, destX, destY, scaleX, scaleY, dest, f);
-            }
-
-            template<typename BlendFunction> void scaleDrawRegion(int sourceX, int sourceY, int sourceX2, int sourceY2,
-                int destX, int destY, double scaleX, double scaleY, Image* dest, BlendFunction f)
-            {
-                // Ensure that the source coordinates stay inside the image.
-                sourceX = std::min(std::max(0, sourceX), width - 1);
-                sourceY = std::min(std::max(0, sourceY), height - 1);
-                sourceX2 = std::min(std::max(0, sourceX2), width - 1);
-                sourceY2 = std::min(std::max(0, sourceY2), height - 1);
-
-                // Keep source rectangle coordinates in order.
-                if (sourceX > sourceX2)
-                {
-                    std::swap(sourceX, sourceX2);
-                }
-                if (sourceY > sourceY2)
-                {
-                    std::swap(sourceY, sourceY2);
-                }
-
-                int sampleX = 0;
-                int sampleY = 0;
-                int sampleX2 = int(scaleX * (sourceX2 - sourceX)) - 1;
-                int sampleY2 = int(scaleY * (sourceY2 - sourceY)) - 1;
-                int destX2 = dx + sampleX2;
-                int destY2 = dy + sampleY2;
-                int fixedScaleX = int(double(sourceX2 - sourceX + 1) * 65536.0 * scaleX);
-                int fixedScaleY = int(double(sourceY2 - sourceY + 1) * 65536.0 * scaleY);
-
-                // Don't draw if completely outside clipping regions.
-                if(destX > dest->clipX2 || destX2 < dest->clipX || destY > dest->clipY2 || destY2 < dest->clipY)
-                {
-                    return;
-                }
-                // Keep sample rectangle inside clipping regions.
-                if(destX < dest->clipX)
-                {
-                    sampleX += dest->clipX - destX;
-                }
-                if(destX2 > dest->clipX2)
-                {
-                    sampleX2 -= destX2 - dest->clipX2;
-                }
-                if(destY < dest->clipY)
-                {
-                    sampleY += dest->clipY - destY;
-                }
-                if(destY2 > dest->clipY2)
-                {
-                    sampleY2 -= destY2 - dest->clipY2;
-                }
-                // Draw the scaled image, pixel for pixel.
-                for(int i = sampleY; i <= sampleY2; i++)
-                {
-                    for(int j = sampleX; j <= sampleX2; j++)
-                    {
-                        int srcPixel = (((i * fixedScaleY + sourceY) >> 16) + sourceY) * width + ((j * fixedScaleX + sourceX) >> 16) + sourceX;
-                        int destPixel = (i + destX) * dest->width + (j + destY);
-                        dest->data[destPixel] = f(data[srcPixel], dest->data[destPixel], opacity);
-                    }
-                }        
-            }
-
-            template<typename BlendFunction> void rotateBlit(int x, int y, double angle, Image* dest, BlendFunction f)
-            {
-                rotateScaleBlitRegion(0, 0, occupiedWidth, occupiedHeight, x, y, angle, 1, dest, f);
-            }
-
-            template<typename BlendFunction> void rotateScaleBlit(int x, int y, double angle, double scale, Image* dest, BlendFunction f)
-            {
-                rotateScaleBlitRegion(0, 0, occupiedWidth, occupiedHeight, x, y, angle, scale, dest, f);
-            }
-
-            template<typename BlendFunction> void rotateBlitRegion(int sourceX, int sourceY, int sourceX2, int sourceY2,
-                int destX, int destY, double angle, Image* dest, BlendFunction blend)
-            {
-                rotateScaleBlitRegion(sourceX, sourceY, sourceX2, sourceY2, destX, destY, angle, 1.0, dest, f);
-            }
-    };
-}
-
+#ifndef VG_GRAPHICS_IMAGE_HPP
+#define VG_GRAPHICS_IMAGE_HPP
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "blend.hpp"
+#include "color.hpp"
+#include "span.hpp"
+#include "filter.hpp"
+#include "polygon.hpp"
+#include "transform.hpp"
+#include "../core/workerpool.hpp"
+
+namespace vg
+{
+    // A rectangle of changed pixels, inclusive on both corners.
+    struct DirtyRect
+    {
+        int x, y, x2, y2;
+
+        bool contains(const DirtyRect& other) const
+        {
+            return other.x >= x && other.x2 <= x2 && other.y >= y && other.y2 <= y2;
+        }
+
+        // Overlapping or sharing an edge, so the two can merge without covering anything new.
+        bool touches(const DirtyRect& other) const
+        {
+            return other.x <= x2 + 1 && other.x2 >= x - 1 && other.y <= y2 + 1 && other.y2 >= y - 1;
+        }
+
+        DirtyRect merged(const DirtyRect& other) const
+        {
+            DirtyRect result = {std::min(x, other.x), std::min(y, other.y), std::max(x2, other.x2), std::max(y2, other.y2)};
+            return result;
+        }
+
+        int getArea() const
+        {
+            return (x2 - x + 1) * (y2 - y + 1);
+        }
+    };
+
+    class Image
+    {
+        private:
+            int width, height;
+            int clipX, clipY, clipX2, clipY2;
+            ColorChannel opacity;
+            Color* data;
+            // Distance in pixels from one row to the next.
+            int pitch;
+            // The allocation behind data, or null for a view of another image's pixels.
+            Color* buffer;
+            // For a view, the image it looks into and where it sits in it.
+            Image* parent;
+            int parentX, parentY;
+            // Counts writes to the pixels of the image that owns them, so views can
+            // tell when their cached alpha metadata has gone stale.
+            unsigned int revision;
+            // Whether the pixels hold premultiplied alpha. Only a label: draws
+            // don't look at it, so pick the matching Blenders.
+            bool premultiplied;
+            // Threads to split big operations across, or null to run them serially.
+            AbstractWorkerPool* workerPool;
+
+            // Alpha metadata, worked out lazily the first time a draw needs it,
+            // and thrown away by anything that writes to the pixels.
+            mutable bool alphaCached;
+            mutable unsigned int alphaRevision;
+            mutable AlphaClass alphaClass;
+            mutable std::vector<AlphaRowInfo> alphaRows;
+
+            // Everything written since the dirty rectangles were last cleared.
+            std::vector<DirtyRect> dirtyRects;
+            // The bounds of everything written since ImagePool last cleared the image,
+            // kept apart from the dirty rectangles, which users clear on their own.
+            // x > x2 when nothing has been.
+            DirtyRect touched;
+            // Pixels the buffer has room for, for ImagePool to reuse it.
+            int capacity;
+            // Buffers for filtered scaled draws onto the image, kept between draws.
+            FilterScratch filterScratch;
+
+            // Called by everything that writes to the pixels, with the area written.
+            void modified(int x, int y, int x2, int y2)
+            {
+                alphaCached = false;
+
+                DirtyRect rect = {std::max(x, 0), std::max(y, 0), std::min(x2, width - 1), std::min(y2, height - 1)};
+                if(rect.x > rect.x2 || rect.y > rect.y2)
+                {
+                    return;
+                }
+                touched = touched.x > touched.x2 ? rect : touched.merged(rect);
+                // Writes through a view change the pixels of every image above it.
+                if(parent)
+                {
+                    parent->modified(rect.x + parentX, rect.y + parentY, rect.x2 + parentX, rect.y2 + parentY);
+                }
+                else
+                {
+                    revision++;
+                }
+                for(size_t i = 0; i < dirtyRects.size(); i++)
+                {
+                    if(dirtyRects[i].contains(rect))
+                    {
+                        return;
+                    }
+                }
+
+                // Fold in everything the new rectangle touches. Merging can make it
+                // touch more, so start over after each one.
+                size_t i = 0;
+                while(i < dirtyRects.size())
+                {
+                    if(rect.touches(dirtyRects[i]))
+                    {
+                        rect = rect.merged(dirtyRects[i]);
+                        dirtyRects.erase(dirtyRects.begin() + i);
+                        i = 0;
+                    }
+                    else
+                    {
+                        i++;
+                    }
+                }
+
+                // Past the limit, merge with whichever rectangle grows the least.
+                if(dirtyRects.size() >= MaxDirtyRects)
+                {
+                    size_t best = 0;
+                    int bestGrowth = 0;
+                    for(i = 0; i < dirtyRects.size(); i++)
+                    {
+                        int growth = rect.merged(dirtyRects[i]).getArea() - dirtyRects[i].getArea();
+                        if(i == 0 || growth < bestGrowth)
+                        {
+                            best = i;
+                            bestGrowth = growth;
+                        }
+                    }
+                    DirtyRect merged = rect.merged(dirtyRects[best]);
+                    dirtyRects.erase(dirtyRects.begin() + best);
+                    modified(merged.x, merged.y, merged.x2, merged.y2);
+                    return;
+                }
+                dirtyRects.push_back(rect);
+            }
+
+            void modified()
+            {
+                modified(0, 0, width - 1, height - 1);
+            }
+
+            // Marks the clipped bounding box of a polygon's points, on pixel corners.
+            void modifiedPolygon(const int* points, int pointCount)
+            {
+                if(pointCount < 3)
+                {
+                    return;
+                }
+                int x = points[0];
+                int y = points[1];
+                int x2 = x;
+                int y2 = y;
+                for(int i = 1; i < pointCount; i++)
+                {
+                    x = std::min(x, points[i * 2]);
+                    y = std::min(y, points[i * 2 + 1]);
+                    x2 = std::max(x2, points[i * 2]);
+                    y2 = std::max(y2, points[i * 2 + 1]);
+                }
+                modified(std::max(x, clipX), std::max(y, clipY), std::min(x2 - 1, clipX2), std::min(y2 - 1, clipY2));
+            }
+
+            // The image that owns the pixels: this one, unless it's a view.
+            const Image* getOwner() const
+            {
+                const Image* owner = this;
+                while(owner->parent)
+                {
+                    owner = owner->parent;
+                }
+                return owner;
+            }
+
+            void updateAlphaInfo() const
+            {
+                unsigned int ownerRevision = getOwner()->revision;
+                if(!alphaCached || alphaRevision != ownerRevision)
+                {
+                    alphaRows.resize(height);
+                    for(int i = 0; i < height; i++)
+                    {
+                        alphaRows[i] = summarizeAlpha(data + i * pitch, width);
+                    }
+                    summarizeAlphaRows();
+                }
+            }
+
+            // Works out the alpha class of the whole image from the rows', and marks the metadata current.
+            void summarizeAlphaRows() const
+            {
+                bool opaque = false;
+                bool transparent = false;
+                bool variable = false;
+                for(int i = 0; i < height; i++)
+                {
+                    switch(alphaRows[i].alphaClass)
+                    {
+                        case AlphaTransparent: transparent = true; break;
+                        case AlphaOpaque: opaque = true; break;
+                        case AlphaBinary: opaque = transparent = true; break;
+                        default: variable = true; break;
+                    }
+                }
+                alphaClass = variable ? AlphaVariable : opaque ? (transparent ? AlphaBinary : AlphaOpaque) : AlphaTransparent;
+                alphaCached = true;
+                alphaRevision = getOwner()->revision;
+            }
+
+            // Calls f(bandY, bandY2) on bands of rows that together cover y..y2, for an
+            // area columns pixels wide. With a worker pool and an area big enough to be
+            // worth it, the bands run in parallel, so f must only write to its own rows.
+            // Whether forEachBand splits rows by columns pixels into bands, rather than running serially.
+            bool splitsIntoBands(int rows, int columns) const
+            {
+                return workerPool && workerPool->getThreadCount() >= 2 && rows >= 2 && rows * columns >= ParallelThreshold;
+            }
+
+            template<typename BandFunction> void forEachBand(int y, int y2, int columns, BandFunction f) const
+            {
+                int rows = y2 - y + 1;
+                if(!splitsIntoBands(rows, columns))
+                {
+                    f(y, y2);
+                    return;
+                }
+                // A few bands per thread, so they still balance out if some are slower.
+                int bands = std::min(rows, workerPool->getThreadCount() * 4);
+                runTask(workerPool, bands, [&](int band)
+                {
+                    f(y + rows * band / bands, y + rows * (band + 1) / bands - 1);
+                });
+            }
+
+        public:
+            // Dirty rectangles past this many get merged together.
+            enum { MaxDirtyRects = 16 };
+
+            // Operations covering fewer pixels than this always run serially.
+            enum { ParallelThreshold = 64 * 1024 };
+
+            // Sets up storage with every row starting on a RowAlignment boundary.
+            static int getAlignedPitch(int width)
+            {
+                return (width + RowAlignmentPixels - 1) / RowAlignmentPixels * RowAlignmentPixels;
+            }
+
+            // Sets up storage with every row starting on a RowAlignment boundary,
+            // with room for at least minimumCapacity pixels.
+            void allocate(int minimumCapacity = 0)
+            {
+                pitch = getAlignedPitch(width);
+                capacity = std::max(pitch * height, minimumCapacity);
+                buffer = new Color[capacity + RowAlignmentPixels - 1];
+                size_t address = (size_t) buffer;
+                data = (Color*) ((address + RowAlignment - 1) / RowAlignment * RowAlignment);
+                resetTouched();
+            }
+
+            void resetTouched()
+            {
+                DirtyRect none = {0, 0, -1, -1};
+                touched = none;
+            }
+
+            // ImagePool hands out images made with this, and reshapes them to reuse them.
+            friend class ImagePool;
+            // PngDecoder and VgiFile too, to skip clearing images they're about to fill,
+            // and TileChunkCache, which clears its chunks to transparent rather than black.
+            friend class PngDecoder;
+            friend class VgiFile;
+            friend class TileChunkCache;
+
+            // An image with uninitialized pixels and room for capacity pixels.
+            Image(int width, int height, int capacity):
+                width(width), height(height),
+                opacity(255),
+                parent(0),
+                parentX(0),
+                parentY(0),
+                revision(0),
+                premultiplied(false),
+                workerPool(0),
+                alphaCached(false)
+            {
+                allocate(capacity);
+                resetClip();
+            }
+
+            // Gives the image a new size in the same buffer, and puts everything else
+            // back the way a new image starts. The pixels are left as they were.
+            void reshape(int width, int height)
+            {
+                this->width = width;
+                this->height = height;
+                pitch = getAlignedPitch(width);
+                opacity = 255;
+                premultiplied = false;
+                workerPool = 0;
+                alphaCached = false;
+                revision++;
+                dirtyRects.clear();
+                resetTouched();
+                resetClip();
+            }
+
+        protected:
+            // An image over pixels it doesn't own, rows pitch pixels apart, for
+            // subclasses that look after the pixels themselves, like MappedImage,
+            // and for DisplayList's tiles of its target.
+            Image(int width, int height, Color* data, int pitch):
+                width(width), height(height),
+                opacity(255),
+                data(data),
+                pitch(pitch),
+                buffer(0),
+                parent(0),
+                parentX(0),
+                parentY(0),
+                revision(0),
+                premultiplied(false),
+                workerPool(0),
+                alphaCached(false),
+                capacity(0)
+            {
+                resetTouched();
+                resetClip();
+            }
+
+            // Takes the alpha metadata from rows worked out ahead of time, one per
+            // row, instead of scanning the pixels for it the first time it's needed.
+            void setAlphaInfo(const AlphaRowInfo* rows)
+            {
+                alphaRows.assign(rows, rows + height);
+                summarizeAlphaRows();
+            }
+
+            // A view of the rectangle x, y - x2, y2 of parent's pixels, for ImageView.
+            // The rectangle is cut down to fit inside the parent, and a rectangle
+            // outside it gives an empty 0x0 view.
+            Image(Image* parent, int x, int y, int x2, int y2):
+                opacity(parent->opacity),
+                buffer(0),
+                parent(parent),
+                revision(0),
+                premultiplied(parent->premultiplied),
+                workerPool(parent->workerPool),
+                alphaCached(false),
+                capacity(0)
+            {
+                if(x > x2)
+                {
+                    std::swap(x, x2);
+                }
+                if(y > y2)
+                {
+                    std::swap(y, y2);
+                }
+                // Intersect with the parent, leaving an empty view if they don't overlap.
+                x = std::max(0, x);
+                y = std::max(0, y);
+                x2 = std::min(x2, parent->width - 1);
+                y2 = std::min(y2, parent->height - 1);
+                if(x > x2 || y > y2)
+                {
+                    x = y = 0;
+                    x2 = y2 = -1;
+                }
+                parentX = x;
+                parentY = y;
+                width = x2 - x + 1;
+                height = y2 - y + 1;
+                pitch = parent->pitch;
+                data = parent->data + parentY * pitch + parentX;
+                resetTouched();
+                resetClip();
+            }
+
+        public:
+            // Rows start on boundaries this many bytes apart, for aligned vector access.
+            enum { RowAlignment = 64 };
+            enum { RowAlignmentPixels = RowAlignment / sizeof(Color) };
+
+            Image(int width, int height):
+                width(width), height(height),
+                opacity(255),
+                parent(0),
+                parentX(0),
+                parentY(0),
+                revision(0),
+                premultiplied(false),
+                workerPool(0),
+                alphaCached(false)
+            {
+                allocate();
+                clear(ColorBlack);
+                resetClip();
+            }
+
+            Image(Image* source):
+                width(source->width), height(source->height),
+                opacity(source->opacity),
+                parent(0),
+                parentX(0),
+                parentY(0),
+                revision(0),
+                premultiplied(source->premultiplied),
+                workerPool(source->workerPool),
+                alphaCached(false)
+            {
+                allocate();
+                source->copyRawData(this);
+                source->getClip(clipX, clipY, clipX2, clipY2);
+            }
+
+            // Virtual for subclasses that let go of their pixels some other way.
+            virtual ~Image()
+            {
+                delete[] buffer;
+            }
+
+            int getWidth() const
+            {
+                return width;
+            }
+
+            int getHeight() const
+            {
+                return height;
+            }
+
+            const Color* getRawData() const
+            {
+                return data;
+            }
+
+            // Distance in pixels from the start of one row of getRawData() to the next.
+            // At least the width, and more for padded rows and views.
+            int getPitch() const
+            {
+                return pitch;
+            }
+
+            // Whether the rows have no gaps between them, so the pixels can be
+            // treated as one width * height block.
+            bool isContiguous() const
+            {
+                return pitch == width;
+            }
+
+            // The image this one is a view of, or null if it owns its pixels.
+            Image* getParent() const
+            {
+                return parent;
+            }
+
+            // Whether the two images are views of the same pixels, or the same image.
+            // Drawing between them can't be split up, since the rows might overlap.
+            bool sharesPixels(const Image* other) const
+            {
+                return getOwner() == other->getOwner();
+            }
+
+            // Writable access to the pixels. This throws away the cached alpha
+            // metadata, so read through a const Image where possible.
+            Color* getRawData()
+            {
+                modified();
+                return data;
+            }
+
+            // Writable access for code that only changes the rectangle x, y - x2, y2.
+            // Returns the whole buffer like getRawData(), but only marks that area dirty.
+            Color* getRawData(int x, int y, int x2, int y2)
+            {
+                modified(std::min(x, x2), std::min(y, y2), std::max(x, x2), std::max(y, y2));
+                return data;
+            }
+
+            // The areas changed since clearDirtyRects(), as a short list of
+            // rectangles that don't touch each other.
+            const std::vector<DirtyRect>& getDirtyRects() const
+            {
+                return dirtyRects;
+            }
+
+            bool isDirty() const
+            {
+                return !dirtyRects.empty();
+            }
+
+            void clearDirtyRects()
+            {
+                dirtyRects.clear();
+            }
+
+            // The alpha class of the whole image, cached until the pixels change.
+            AlphaClass getAlphaClass() const
+            {
+                updateAlphaInfo();
+                return alphaClass;
+            }
+
+            // The alpha summary of one row, cached until the pixels change.
+            const AlphaRowInfo& getAlphaRowInfo(int y) const
+            {
+                updateAlphaInfo();
+                return alphaRows[y];
+            }
+
+            ColorChannel getOpacity() const
+            {
+                return opacity;
+            }
+
+            void setOpacity(ColorChannel opacity)
+            {
+                this->opacity = opacity;
+            }
+
+            AbstractWorkerPool* getWorkerPool() const
+            {
+                return workerPool;
+            }
+
+            // Opts in to splitting clear, replaceColor, rectFill and draws onto
+            // this image into bands of rows, run on the given pool. Pass null
+            // to go back to running serially. The pool must outlive the image.
+            void setWorkerPool(AbstractWorkerPool* workerPool)
+            {
+                this->workerPool = workerPool;
+            }
+
+            bool isPremultiplied() const
+            {
+                return premultiplied;
+            }
+
+            // Converts the pixels to premultiplied alpha, for drawing with the
+            // Premultiplied Blenders. Meant to be done once, right after loading.
+            void premultiply()
+            {
+                if(!premultiplied)
+                {
+                    for(int y = 0; y < height; y++)
+                    {
+                        Color* row = data + y * pitch;
+                        for(int x = 0; x < width; x++)
+                        {
+                            row[x] = premultiplyColor(row[x]);
+                        }
+                    }
+                    premultiplied = true;
+                    modified();
+                }
+            }
+
+            // Converts the pixels back to straight alpha.
+            void unpremultiply()
+            {
+                if(premultiplied)
+                {
+                    for(int y = 0; y < height; y++)
+                    {
+                        Color* row = data + y * pitch;
+                        for(int x = 0; x < width; x++)
+                        {
+                            row[x] = unpremultiplyColor(row[x]);
+                        }
+                    }
+                    premultiplied = false;
+                    modified();
+                }
+            }
+
+            int getPixel(int x, int y) const
+            {
+                if(x >= 0 && x < width && y >= 0 && y < height)
+                {
+                    return data[y * pitch + x];
+                }
+                else
+                {
+                    return 0;
+                }
+            }
+
+            void setPixel(int x, int y, Color color)
+            {
+                if(x >= clipX && x <= clipX2 && y >= clipY && y <= clipY2)
+                {
+                    data[y * pitch + x] = color;
+                    modified(x, y, x, y);
+                }
+            }
+
+            void getClip(int& x, int& y, int& x2, int& y2) const
+            {
+                x = clipX;
+                y = clipY;
+                x2 = clipX2;
+                y2 = clipY2;
+            }
+
+            void resetClip()
+            {
+                setClip(0, 0, width - 1, height - 1);
+            }
+
+            void setClip(int x, int y, int x2, int y2)
+            {
+                if(x > x2)
+                {
+                    std::swap(x, x2);
+                }
+                if(y > y2)
+                {
+                    std::swap(y, y2);
+                }
+                // An empty image gets an empty clip, with clipX past clipX2.
+                clipX = std::max(0, std::min(x, width - 1));
+                clipY = std::max(0, std::min(y, height - 1));
+                clipX2 = std::min(std::max(0, x2), width - 1);
+                clipY2 = std::min(std::max(0, y2), height - 1);
+            }
+
+            void copyRawData(Image* dest)
+            {
+                if(width == dest->width && height == dest->height)
+                {
+                    if(isContiguous() && dest->isContiguous())
+                    {
+                        std::memcpy(dest->data, data, width * height * sizeof(*data));
+                    }
+                    else
+                    {
+                        for(int y = 0; y < height; y++)
+                        {
+                            std::memcpy(dest->data + y * dest->pitch, data + y * pitch, width * sizeof(*data));
+                        }
+                    }
+                    dest->modified();
+                }
+            }
+
+            void clear(Color color)
+            {
+                modified();
+                forEachBand(0, height - 1, width, [&](int y, int y2)
+                {
+                    for(int i = y; i <= y2; i++)
+                    {
+                        fillSpan(color, data + i * pitch, width);
+                    }
+                });
+            }
+
+            void replaceColor(Color find, Color replacement)
+            {
+                modified();
+                forEachBand(0, height - 1, width, [&](int y, int y2)
+                {
+                    for(int i = y; i <= y2; i++)
+                    {
+                        Color* row = data + i * pitch;
+                        for(int j = 0; j < width; j++)
+                        {
+                            if(row[j] == find)
+                            {
+                                row[j] = replacement;
+                            }
+                        }
+                    }
+                });
+            }
+
+            void flip(bool horizontal, bool vertical)
+            {
+                modified();
+                if(horizontal)
+                {
+                    for(int y = 0; y < height; y++)
+                    {
+                        for(int x = 0; x < width / 2; x++)
+                        {
+                            std::swap(data[y * pitch + x], data[y * pitch + (width - x - 1)]);
+                        }
+                    }
+                }
+                if(vertical)
+                {
+                    for(int y = 0; y < height / 2; y++)
+                    {
+                        for(int x = 0; x < width; x++)
+                        {
+                            std::swap(data[y * pitch + x], data[(height - y - 1) * pitch + x]);
+                        }
+                    }
+                }
+            }
+
+            template<typename BlendFunction> void rect(int x, int y, int x2, int y2, Color color, BlendFunction f)
+            {
+                // Put the coordinates in order.
+                if(x > x2)
+                {
+                    std::swap(x, x2);
+                }
+                if(y > y2)
+                {
+                    std::swap(y, y2);
+                }
+                // Don't draw if completely outside clipping regions.
+                if(x > clipX2 || y > clipY2 || x2 < clipX || y2 < clipY)
+                {
+                    return;
+                }
+                modified(std::max(x, clipX), std::max(y, clipY), std::min(x2, clipX2), std::min(y2, clipY2));
+                // Draw the horizontal lines of a rectangle, cut down to the clipping region.
+                int left = std::max(x, clipX);
+                int right = std::min(x2, clipX2);
+                if(y >= clipY)
+                {
+                    blendColorSpan(color, data + y * pitch + left, right - left + 1, opacity, f);
+                }
+                if(y2 != y && y2 <= clipY2)
+                {
+                    blendColorSpan(color, data + y2 * pitch + left, right - left + 1, opacity, f);
+                }
+                // Draw the vertical lines of a rectangle, between the corners.
+                int top = std::max(y + 1, clipY);
+                int bottom = std::min(y2 - 1, clipY2);
+                for(int i = top; i <= bottom; i++)
+                {
+                    if(x >= clipX)
+                    {
+                        data[i * pitch + x] = f(color, data[i * pitch + x], opacity);
+                    }
+                    if(x2 != x && x2 <= clipX2)
+                    {
+                        data[i * pitch + x2] = f(color, data[i * pitch + x2], opacity);
+                    }
+                }
+            }
+
+            template<typename BlendFunction> void rectFill(int x, int y, int x2, int y2, Color color, BlendFunction f)
+            {
+                // Put the coordinates in order.
+                if(x > x2)
+                {
+                    std::swap(x, x2);
+                }
+                if(y > y2)
+                {
+                    std::swap(y, y2);
+                }
+                // Don't draw if completely outside clipping regions.
+                if(x > clipX2 || y > clipY2 || x2 < clipX || y2 < clipY)
+                {
+                    return;
+                }
+                // Keep rectangle inside clipping regions
+                if(x < clipX)
+                {
+                    x = clipX;
+                }
+                if(x2 > clipX2)
+                {
+                    x2 = clipX2;
+                }
+                if(y < clipY)
+                {
+                    y = clipY;
+                }
+                if(y2 > clipY2)
+                {
+                    y2 = clipY2;
+                }
+                modified(x, y, x2, y2);
+                // Draw a filled rectangle, one span per row.
+                forEachBand(y, y2, x2 - x + 1, [&](int bandY, int bandY2)
+                {
+                    for(int i = bandY; i <= bandY2; i++)
+                    {
+                        blendColorSpan(color, data + i * pitch + x, x2 - x + 1, opacity, f);
+                    }
+                });
+            }
+
+            template<typename BlendFunction> void line(int x, int y, int x2, int y2, Color color, BlendFunction f)
+            {
+                enum
+                {
+                    None = 0,
+                    Left = 1,
+                    Right = 2,
+                    Top = 4,
+                    Bottom = 8
+                };
+
+                // Now we'll clip the line using Cohen-Sutherland clipping
+                // (this source adapted from ika)
+                unsigned int c1 = None;
+                unsigned int c2 = None;
+
+                // Silly region code things to start us off
+                if(x < clipX)   c1 |= Left;
+                if(x > clipX2)  c1 |= Right;
+                if(y < clipY)   c1 |= Top;
+                if(y > clipY2)  c1 |= Bottom;
+                if(x2 < clipX)  c2 |= Left;
+                if(x2 > clipX2) c2 |= Right;
+                if(y2 < clipY)  c2 |= Top;
+                if(y2 > clipY2) c2 |= Bottom;
+
+                // Keep clipping until we either accept or reject this line.
+                while(!(c1 & c2) && (c1 | c2))
+                {
+                    if(c1)
+                    {
+                        // Clip left.
+                        if(c1 & Left)
+                        {
+                            y -= ((y - y2) * (clipX - x)) / (x2 - x + 1);
+                            x = clipX;
+                        }
+                        // Clip right.
+                        else if(c1 & Right)
+                        {
+                            y -= ((y - y2) * (x - clipX2)) / (x2 - x + 1);
+                            x = clipX2;
+                        }
+                        // Clip above.
+                        else if(c1 & Top)
+                        {
+                            x -= ((x - x2) * (clipY - y)) / (y2 - y + 1);
+                            y = clipY;
+                        }
+                        // Clip below.
+                        else
+                        {
+                            x -= ((x - x2) * (y - clipY2)) / (y2 - y + 1);
+                            y = clipY2;
+                        }
+                        // Recheck all the region codes for this side of the line.
+                        c1 = None;
+                        if(x < clipX)   c1 |= Left;
+                        if(x > clipX2)  c1 |= Right;
+                        if(y < clipY)   c1 |= Top;
+                        if(y > clipY2)  c1 |= Bottom;
+                    }
+                    else
+                    {
+                        // Clip left.
+                        if(c2 & Left)
+                        {
+                            y2 -= ((y2 - y) * (clipX - x2)) / (x - x2 + 1);
+                            x2 = clipX;
+                        }
+                        // Clip right.
+                        else if(c2 & Right)
+                        {
+                            y2 -= ((y2 - y) * (x2 - clipX2)) / (x - x2 + 1);
+                            x2 = clipX2;
+                        }
+                        // Clip above.
+                        else if(c2 & Top)
+                        {
+                            x2 -= ((x2 - x) * (clipY - y2)) / (y - y2 + 1);
+                            y2 = clipY;
+                        }
+                        // Clip below.
+                        else
+                        {
+                            x2 -= ((x2 - x) * (y2 - clipY2)) / (y - y2 + 1);
+                            y2 = clipY2;
+                        }
+                        // Recheck all the region codes for this side of the line.
+                        c2 = None;
+                        if(x2 < clipX)  c2 |= Left;
+                        if(x2 > clipX2) c2 |= Right;
+                        if(y2 < clipY)  c2 |= Top;
+                        if(y2 > clipY2) c2 |= Bottom;
+                    }
+                }
+                // Don't draw if completely outside clipping regions.
+                if(c1 & c2)
+                {
+                    return;
+                }
+                modified(std::min(x, x2), std::min(y, y2), std::max(x, x2), std::max(y, y2));
+                // A single pixel
+                if(x == x2 && y == y2)
+                {
+                    data[y * pitch + x] = f(color, data[y * pitch + x], opacity);
+                }
+                // Horizontal line
+                else if(y == y2)
+                {
+                    // Put the coordinates in order.
+                    if (x > x2)
+                    {
+                        std::swap(x, x2);
+                    }
+                    // Draw it.
+                    blendColorSpan(color, data + y * pitch + x, x2 - x + 1, opacity, f);
+                }
+                // Vertical line
+                else if(x == x2)
+                {
+                    // Put the coordinates in order.
+                    if (y > y2)
+                    {
+                        std::swap(y, y2);
+                    }
+                    // Draw it.
+                    for(int i = y; i <= y2; i++)
+                    {
+                        data[i * pitch + x] = f(color, data[i * pitch + x], opacity);
+                    }
+                }
+                else
+                {
+                    // Time for some Bresenham.
+                    int differenceX = std::abs(x2 - x);
+                    int differenceY = std::abs(y2 - y);
+                    int deltaX = (x > x2) ? -1 : 1;
+                    int deltaY = (y > y2) ? -1 : 1;
+
+                    int errorX, errorY;
+                    int incrementX, incrementY;
+                    int resetX, resetY;
+
+                    if(differenceX > differenceY)
+                    {
+                        errorX = 0;
+                        errorY = differenceY * 2 - differenceX;
+                        incrementX = 0;
+                        incrementY = differenceY * 2;
+                        resetX = 0;
+                        resetY = (differenceY - differenceX) * 2;
+                    }
+                    else
+                    {
+                        errorX = differenceX * 2 - differenceY;
+                        errorY = 0;
+                        incrementX = differenceX * 2;
+                        incrementY = 0;
+                        resetX = (differenceX - differenceY) * 2;
+                        resetY = 0;
+                    }
+
+                    data[y * pitch + x] = f(color, data[y * pitch + x], opacity);
+                    do
+                    {
+                        if(errorX < 0)
+                        {
+                            errorX += incrementX;
+                        }
+                        else
+                        {
+                            x += deltaX;
+                            errorX += resetX;
+                        }
+
+                        if(errorY < 0)
+                        {
+                            errorY += incrementY;
+                        }
+                        else
+                        {
+                            y += deltaY;
+                            errorY += resetY;
+                        }
+                        data[y * pitch + x] = f(color, data[y * pitch + x], opacity);
+                    } while((resetX || x != x2) && (resetY || y != y2));
+                }
+            }
+
+            template<typename BlendFunction> void ellipse(int cx, int cy, int radiusX, int radiusY, Color color, BlendFunction f)
+            {
+                // Algorithm based on "A Fast Bresenham Type Algorithm For Drawing Ellipses" by John Kennedy <rkennedy@ix.netcom.com>
+                modified(std::max(cx - std::abs(radiusX), clipX), std::max(cy - std::abs(radiusY), clipY),
+                    std::min(cx + std::abs(radiusX), clipX2), std::min(cy + std::abs(radiusY), clipY2));
+                int plotX, plotY;
+
+                int lastX = -1;
+                int lastY = -1;
+                int a = 2 * radiusX * radiusX;
+                int b = 2 * radiusY * radiusY;
+                int x = radiusX;
+                int y = 0;
+                int deltaX = radiusY * radiusY * (1 - 2 * radiusX);
+                int deltaY = radiusX * radiusX;
+                int ellipseError = 0;
+                int stoppingX = b * radiusX;
+                int stoppingY = 0;
+
+                // First set of points, y' > -1
+                while(stoppingX >= stoppingY)
+                {
+                    if(lastX != x || lastY != y)
+                    {
+                        int plotY = cy - y;
+                        if(plotY >= clipY && plotY <= clipY2)
+                        {
+                            int plotX = cx - x;
+                            if(plotX >= clipX && plotX <= clipX2)
+                            {
+                                data[plotY * pitch + plotX] = f(color, data[plotY * pitch + plotX], opacity);
+                            }
+                            plotX = cx + x;
+                            if(plotX >= clipX && plotX <= clipX2)
+                            {
+                                data[plotY * pitch + plotX] = f(color, data[plotY * pitch + plotX], opacity);
+                            }
+                        }
+                        if(y)
+                        {
+                            plotY = cy + y;
+                            if(plotY >= clipY && plotY <= clipY2)
+                            {
+                                int plotX = cx - x;
+                                if(plotX >= clipX && plotX <= clipX2)
+                                {
+                                    data[plotY * pitch + plotX] = f(color, data[plotY * pitch + plotX], opacity);
+                                }
+                                plotX = cx + x;
+                                if(plotX >= clipX && plotX <= clipX2)
+                                {
+                                    data[plotY * pitch + plotX] = f(color, data[plotY * pitch + plotX], opacity);
+                                }
+                            }
+                        }
+                        lastX = x;
+                        lastY = y;
+                    }
+
+                    y++;
+                    stoppingY += a;
+                    ellipseError += deltaY;
+                    deltaY += a;
+                    if(ellipseError * 2 + deltaX > 0)
+                    {
+                        x--;
+                        stoppingX -= b;
+                        ellipseError += deltaX;
+                        deltaX += b;
+                    }
+                }
+
+                // First point set is done; start the second set of points
+                x = 0;
+                y = radiusY;
+                deltaX = radiusY * radiusY;
+                deltaY = radiusX * radiusX * (1 - radiusY * 2);
+                ellipseError = 0;
+                stoppingX = 0;
+                stoppingY = a * radiusY;
+
+                // Second set of points, y' < -1
+                while(stoppingX <= stoppingY)
+                {
+                    if(lastX != x || lastY != y)
+                    {
+                        int plotY = cy - y;
+                        if(plotY >= clipY && plotY <= clipY2)
+                        {
+                            int plotX = cx - x;
+                            if(plotX >= clipX && plotX <= clipX2)
+                            {
+                                data[plotY * pitch + plotX] = f(color, data[plotY * pitch + plotX], opacity);
+                            }
+                            if(x)
+                            {
+                                plotX = cx + x;
+                                if(plotX >= clipX && plotX <= clipX2)
+                                {
+                                    data[plotY * pitch + plotX] = f(color, data[plotY * pitch + plotX], opacity);
+                                }
+                            }
+                        }
+                        if(y)
+                        {
+                            plotY = cy + y;
+                            if(plotY >= clipY && plotY <= clipY2)
+                            {
+                                int plotX = cx - x;
+                                if(plotX >= clipX && plotX <= clipX2)
+                                {
+                                    data[plotY * pitch + plotX] = f(color, data[plotY * pitch + plotX], opacity);
+                                }
+                                if(x)
+                                {
+                                    plotX = cx + x;
+                                    if(plotX >= clipX && plotX <= clipX2)
+                                    {
+                                        data[plotY * pitch + plotX] = f(color, data[plotY * pitch + plotX], opacity);
+                                    }
+                                }
+                            }
+                        }
+                        lastX = x;
+                        lastY = y;
+                    }
+
+                    x++;
+                    ellipseError += deltaX;
+                    deltaX += b;
+                    stoppingX += b;
+                    if(ellipseError * 2 + deltaY > 0)
+                    {
+                        y--;
+                        ellipseError += deltaY;
+                        deltaY += a;
+                        stoppingY -= a;
+                    }
+                }
+            }
+
+            template<typename BlendFunction> void ellipseFill(int cx, int cy, int radiusX, int radiusY, Color color, BlendFunction f)
+            {
+                // Algorithm based on "A Fast Bresenham Type Algorithm For Drawing Ellipses" by John Kennedy <rkennedy@ix.netcom.com>
+                modified(std::max(cx - std::abs(radiusX), clipX), std::max(cy - std::abs(radiusY), clipY),
+                    std::min(cx + std::abs(radiusX), clipX2), std::min(cy + std::abs(radiusY), clipY2));
+                int lastY = -1;
+                int a = 2 * radiusX * radiusX;
+                int b = 2 * radiusY * radiusY;
+                int x = radiusX;
+                int y = 0;
+                int deltaX = radiusY * radiusY * (1 - 2 * radiusX);
+                int deltaY = radiusX * radiusX;
+                int ellipseError = 0;
+                int stoppingX = b * radiusX;
+                int stoppingY = 0;
+
+                // First set of points, y' > -1
+                while(stoppingX >= stoppingY)
+                {
+                    if(lastY != y)
+                    {
+                        int plotX = std::max(cx - x, clipX);
+                        int plotX2 = std::min(cx + x, clipX2);
+                        int plotY = cy - y;
+                        if(plotY >= clipY && plotY <= clipY2 && plotX <= plotX2)
+                        {
+                            blendColorSpan(color, data + plotY * pitch + plotX, plotX2 - plotX + 1, opacity, f);
+                        }
+                        if(y)
+                        {
+                            plotY = cy + y;
+                            if(plotY >= clipY && plotY <= clipY2 && plotX <= plotX2)
+                            {
+                                blendColorSpan(color, data + plotY * pitch + plotX, plotX2 - plotX + 1, opacity, f);
+                            }
+                            lastY = y;
+                        }
+                    }
+
+                    y++;
+                    stoppingY += a;
+                    ellipseError += deltaY;
+                    deltaY += a;
+                    if(ellipseError * 2 + deltaX > 0)
+                    {
+                        x--;
+                        stoppingX -= b;
+                        ellipseError += deltaX;
+                        deltaX += b;
+                    }
+                }
+
+                // First point set is done; start the second set of points
+                x = 0;
+                y = radiusY;
+                deltaX = radiusY * radiusY;
+                deltaY = radiusX * radiusX * (1 - radiusY * 2);
+                ellipseError = 0;
+                stoppingX = 0;
+                stoppingY = a * radiusY;
+
+                // Second set of points, y' < -1
+                while(stoppingX <= stoppingY)
+                {
+                    if(lastY != y)
+                    {
+                        int plotX = std::max(cx - x, clipX);
+                        int plotX2 = std::min(cx + x, clipX2);
+                        int plotY = cy - y;
+                        if(plotY >= clipY && plotY <= clipY2 && plotX <= plotX2)
+                        {
+                            blendColorSpan(color, data + plotY * pitch + plotX, plotX2 - plotX + 1, opacity, f);
+                        }
+                        plotY = cy + y;
+                        if(plotY >= clipY && plotY <= clipY2 && plotX <= plotX2)
+                        {
+                            blendColorSpan(color, data + plotY * pitch + plotX, plotX2 - plotX + 1, opacity, f);
+                        }
+                        lastY = y;
+                    }
+
+                    x++;
+                    ellipseError += deltaX;
+                    deltaX += b;
+                    stoppingX += b;
+                    if(ellipseError * 2 + deltaY > 0)
+                    {
+                        y--;
+                        ellipseError += deltaY;
+                        deltaY += a;
+                        stoppingY -= a;
+                    }
+                }
+            }
+
+            // Fills a polygon given as pointCount x, y pairs on pixel corners, with the
+            // rules of fillPolygonSpans: concave and self-intersecting shapes work, and
+            // shapes that share an edge don't overlap.
+            template<typename BlendFunction> void polygonFill(const int* points, int pointCount, Color color, BlendFunction f)
+            {
+                modifiedPolygon(points, pointCount);
+                fillPolygonSpans(points, pointCount, clipX, clipY, clipX2, clipY2, [&](int y, int x, int x2)
+                {
+                    blendColorSpan(color, data + y * pitch + x, x2 - x + 1, opacity, f);
+                });
+            }
+
+            template<typename BlendFunction> void triangleFill(int x, int y, int x2, int y2, int x3, int y3, Color color, BlendFunction f)
+            {
+                int points[] = {x, y, x2, y2, x3, y3};
+                polygonFill(points, 3, color, f);
+            }
+
+            // Fills a triangle with part of texture, mapped affinely. Each corner has a
+            // position here and a position u, v in the texture, both on pixel corners.
+            // Texture positions past its edges repeat the edge pixels.
+            template<typename BlendFunction> void texturedTriangleFill(int x, int y, int u, int v,
+                int x2, int y2, int u2, int v2, int x3, int y3, int u3, int v3, Image* texture, BlendFunction f)
+            {
+                // An empty view has no texels to sample.
+                if(texture->width == 0 || texture->height == 0)
+                {
+                    return;
+                }
+                // How u and v change per pixel across and down, from the triangle's plane equations.
+                double area = double(x2 - x) * (y3 - y) - double(x3 - x) * (y2 - y);
+                if(area == 0)
+                {
+                    return;
+                }
+                double stepUX = (double(u2 - u) * (y3 - y) - double(u3 - u) * (y2 - y)) / area;
+                double stepVX = (double(v2 - v) * (y3 - y) - double(v3 - v) * (y2 - y)) / area;
+                double stepUY = (double(u3 - u) * (x2 - x) - double(u2 - u) * (x3 - x)) / area;
+                double stepVY = (double(v3 - v) * (x2 - x) - double(v2 - v) * (x3 - x)) / area;
+                // 16.16 fixed point, but wide, so big textures and coordinates don't overflow.
+                long long fixedStepU = (long long) std::floor(stepUX * 65536.0 + 0.5);
+                long long fixedStepV = (long long) std::floor(stepVX * 65536.0 + 0.5);
+
+                int points[] = {x, y, x2, y2, x3, y3};
+                modifiedPolygon(points, 3);
+                const Color* textureData = texture->data;
+                int texturePitch = texture->pitch;
+                int lastU = texture->width - 1;
+                int lastV = texture->height - 1;
+                ColorChannel textureOpacity = texture->opacity;
+                fillPolygonSpans(points, 3, clipX, clipY, clipX2, clipY2, [&](int spanY, int spanX, int spanX2)
+                {
+                    // Texture position under the first pixel's centre.
+                    double offsetX = spanX + 0.5 - x;
+                    double offsetY = spanY + 0.5 - y;
+                    long long fixedU = (long long) std::floor((u + offsetX * stepUX + offsetY * stepUY) * 65536.0);
+                    long long fixedV = (long long) std::floor((v + offsetX * stepVX + offsetY * stepVY) * 65536.0);
+
+                    Color row[SpanBufferSize];
+                    Color* destRow = data + spanY * pitch;
+                    for(int j = spanX; j <= spanX2; j += SpanBufferSize)
+                    {
+                        int count = std::min<int>(spanX2 - j + 1, SpanBufferSize);
+                        for(int k = 0; k < count; k++, fixedU += fixedStepU, fixedV += fixedStepV)
+                        {
+                            int sampleU = int(std::min(std::max(fixedU >> 16, 0LL), (long long) lastU));
+                            int sampleV = int(std::min(std::max(fixedV >> 16, 0LL), (long long) lastV));
+                            row[k] = textureData[sampleV * texturePitch + sampleU];
+                        }
+                        blendSpan(row, destRow + j, count, textureOpacity, f);
+                    }
+                });
+            }
+
+            template<typename BlendFunction> void draw(int x, int y, Image* dest, BlendFunction f)
+            {
+                drawRegion(0, 0, width - 1, height - 1, x, y, dest, f);
+            }
+
+        private:
+            // Blends source pixels x..x2 of a row onto dest, using the row's cached
+            // alpha summary: transparent ends are skipped, and the opaque middle goes
+            // through the opaque specialization.
+            template<OpacityClass Opacity, typename BlendFunction> void blendCachedRow(int y, int x, int x2, Color* dest, ColorChannel opacity, BlendFunction f) const
+            {
+                const AlphaRowInfo& info = alphaRows[y];
+                const Color* source = data + y * pitch;
+                int left = std::max(x, info.left);
+                int right = std::min(x2, info.right);
+                if(left > right)
+                {
+                    return;
+                }
+
+                dest -= x;
+                switch(info.alphaClass)
+                {
+                    case AlphaOpaque:
+                        ClassifiedSpan<Opacity, AlphaOpaque>::blend(source + left, dest + left, right - left + 1, opacity, f);
+                        break;
+                    case AlphaBinary:
+                        ClassifiedSpan<Opacity, AlphaBinary>::blend(source + left, dest + left, right - left + 1, opacity, f);
+                        break;
+                    default:
+                    {
+                        int opaqueLeft = std::max(left, info.opaqueLeft);
+                        int opaqueRight = std::min(right, info.opaqueRight);
+                        if(opaqueLeft > opaqueRight)
+                        {
+                            ClassifiedSpan<Opacity, AlphaVariable>::blend(source + left, dest + left, right - left + 1, opacity, f);
+                        }
+                        else
+                        {
+                            ClassifiedSpan<Opacity, AlphaVariable>::blend(source + left, dest + left, opaqueLeft - left, opacity, f);
+                            ClassifiedSpan<Opacity, AlphaOpaque>::blend(source + opaqueLeft, dest + opaqueLeft, opaqueRight - opaqueLeft + 1, opacity, f);
+                            ClassifiedSpan<Opacity, AlphaVariable>::blend(source + opaqueRight + 1, dest + opaqueRight + 1, right - opaqueRight, opacity, f);
+                        }
+                        break;
+                    }
+                }
+            }
+
+            // Blends source pixels x, y - x2, y2 onto dest, with x, y landing on destX, destY.
+            // Nothing is clipped or marked dirty here, and Blenders that skip transparent
+            // pixels need the alpha metadata to be up to date already.
+            template<OpacityClass Opacity, typename BlendFunction> void blendRows(int x, int y, int x2, int y2,
+                int destX, int destY, Image* dest, ColorChannel opacity, BlendFunction f) const
+            {
+                int span = x2 - x + 1;
+                for(int i = y; i <= y2; i++)
+                {
+                    Color* destRow = dest->data + (destY + i - y) * dest->pitch + destX;
+                    if(BlendTraits<BlendFunction>::SkipsTransparent)
+                    {
+                        blendCachedRow<Opacity>(i, x, x2, destRow, opacity, f);
+                    }
+                    else
+                    {
+                        blendSpan(data + i * pitch + x, destRow, span, opacity, f);
+                    }
+                }
+            }
+
+            template<OpacityClass Opacity, typename BlendFunction> void baseDrawRegion(int sourceX, int sourceY, int sourceX2, int sourceY2,
+                    int destX, int destY, Image* dest, ColorChannel opacity, BlendFunction f)
+            {
+                // Ensure that the source coordinates stay inside the image, which
+                // an empty view has none of.
+                if(width == 0 || height == 0)
+                {
+                    return;
+                }
+                sourceX = std::min(std::max(0, sourceX), width - 1);
+                sourceY = std::min(std::max(0, sourceY), height - 1);
+                sourceX2 = std::min(std::max(0, sourceX2), width - 1);
+                sourceY2 = std::min(std::max(0, sourceY2), height - 1);
+
+                // Keep source rectangle coordinates in order.
+                if (sourceX > sourceX2)
+                {
+                    std::swap(sourceX, sourceX2);
+                }
+                if (sourceY > sourceY2)
+                {
+                    std::swap(sourceY, sourceY2);
+                }
+
+                int destX2 = destX + (sourceX2 - sourceX);
+                int destY2 = destY + (sourceY2 - sourceY);
+
+                // Don't draw if completely outside clipping regions.
+                if(destX > dest->clipX2 || destX2 < dest->clipX || destY > dest->clipY2 || destY2 < dest->clipY)
+                {
+                    return;
+                }
+
+                // Keep sample rectangle inside clipping regions.
+                if(destX < dest->clipX)
+                {
+                    sourceX += dest->clipX - destX;
+                    destX = dest->clipX;
+                }
+                if(destX2 > dest->clipX2)
+                {
+                    sourceX2 -= destX2 - dest->clipX2;
+                }
+                if(destY < dest->clipY)
+                {
+                    sourceY += dest->clipY - destY;
+                    destY = dest->clipY;
+                }
+                if(destY2 > dest->clipY2)
+                {
+                    sourceY2 -= destY2 - dest->clipY2;
+                }
+
+                // Blenders that can skip transparent pixels use the cached alpha
+                // metadata, to find the spans to skip or copy outright.
+                if(BlendTraits<BlendFunction>::SkipsTransparent)
+                {
+                    updateAlphaInfo();
+                }
+                dest->modified(destX, destY, destX + sourceX2 - sourceX, destY + sourceY2 - sourceY);
+
+                // Draw the image, a row span at a time.
+                int span = sourceX2 - sourceX + 1;
+                auto drawRows = [&](int bandY, int bandY2)
+                {
+                    this->blendRows<Opacity>(sourceX, bandY, sourceX2, bandY2, destX, destY + bandY - sourceY, dest, opacity, f);
+                };
+                // Drawing onto itself depends on the rows going in order.
+                if(sharesPixels(dest))
+                {
+                    drawRows(sourceY, sourceY2);
+                }
+                else
+                {
+                    dest->forEachBand(sourceY, sourceY2, span, drawRows);
+                }
+            }
+
+        public:
+            void drawRegion(int sourceX, int sourceY, int sourceX2, int sourceY2, int destX, int destY, Image* dest, CopyBlender f)
+            {
+                // No clipping, and drawing the full source in copy blend? Just copy it raw.
+                if(sourceX == 0 && sourceY == 0 && sourceX2 == width - 1 && sourceY2 == height - 1
+                    && destX == 0 && destY == 0 && dest->width == width && dest->height == height
+                    && dest->clipX == 0 && dest->clipY == 0 && dest->clipX2 == width - 1 && dest->clipY2 == height - 1)
+                {
+                    copyRawData(dest);
+                }
+                else
+                {
+                    baseDrawRegion<OpacityFull>(sourceX, sourceY, sourceX2, sourceY2, destX, destY, dest, opacity, f);
+                }
+            }
+
+            template<typename BlendFunction> void drawRegion(int sourceX, int sourceY, int sourceX2, int sourceY2,
+                    int destX, int destY, Image* dest, BlendFunction f)
+            {
+                drawRegionAtOpacity(sourceX, sourceY, sourceX2, sourceY2, destX, destY, dest, opacity, f);
+            }
+
+            template<typename BlendFunction> void scaleDraw(int destX, int destY, double scaleX, double scaleY, Image* dest, BlendFunction f,
+                ScaleFilter filter = ScaleNearest)
+            {
+                scaleDrawRegion(0, 0, width - 1, height - 1, destX, destY, scaleX, scaleY, dest, f, filter);
+            }
+
+            template<typename BlendFunction> void scaleDrawRegion(int sourceX, int sourceY, int sourceX2, int sourceY2,
+                int destX, int destY, double scaleX, double scaleY, Image* dest, BlendFunction f, ScaleFilter filter = ScaleNearest)
+            {
+                scaleDrawRegionAtOpacity(sourceX, sourceY, sourceX2, sourceY2, destX, destY, scaleX, scaleY, dest, opacity, f, filter);
+            }
+
+        private:
+            // DisplayList records draws with the opacity at the time, and plays them back later.
+            friend class DisplayList;
+            // SpriteBatch clips and culls its sprites together, then blends their rows directly,
+            // through the BlendOperations for each sprite's BlendMode.
+            friend class SpriteBatch;
+            template<typename BlendFunction> friend struct BlendInstantiation;
+
+            // The draws, with the opacity passed in rather than taken from the image.
+            void drawRegionAtOpacity(int sourceX, int sourceY, int sourceX2, int sourceY2,
+                    int destX, int destY, Image* dest, ColorChannel, CopyBlender f)
+            {
+                drawRegion(sourceX, sourceY, sourceX2, sourceY2, destX, destY, dest, f);
+            }
+
+            template<typename BlendFunction> void drawRegionAtOpacity(int sourceX, int sourceY, int sourceX2, int sourceY2,
+                    int destX, int destY, Image* dest, ColorChannel opacity, BlendFunction f)
+            {
+                if(BlendTraits<BlendFunction>::SkipsTransparent && getAlphaClass() == AlphaTransparent)
+                {
+                    return;
+                }
+                // Pick the specialization for this image's opacity once per draw.
+                switch(classifyOpacity(opacity))
+                {
+                    case OpacityZero:
+                        if(!BlendTraits<BlendFunction>::SkipsTransparent)
+                        {
+                            baseDrawRegion<OpacityZero>(sourceX, sourceY, sourceX2, sourceY2, destX, destY, dest, opacity, f);
+                        }
+                        break;
+                    case OpacityFull:
+                        baseDrawRegion<OpacityFull>(sourceX, sourceY, sourceX2, sourceY2, destX, destY, dest, opacity, f);
+                        break;
+                    default:
+                        baseDrawRegion<OpacityPartial>(sourceX, sourceY, sourceX2, sourceY2, destX, destY, dest, opacity, f);
+                        break;
+                }
+            }
+
+            template<typename BlendFunction> void scaleDrawRegionAtOpacity(int sourceX, int sourceY, int sourceX2, int sourceY2,
+                int destX, int destY, double scaleX, double scaleY, Image* dest, ColorChannel opacity, BlendFunction f, ScaleFilter filter)
+            {
+                // Ensure that the source coordinates stay inside the image, which
+                // an empty view has none of.
+                if(width == 0 || height == 0)
+                {
+                    return;
+                }
+                sourceX = std::min(std::max(0, sourceX), width - 1);
+                sourceY = std::min(std::max(0, sourceY), height - 1);
+                sourceX2 = std::min(std::max(0, sourceX2), width - 1);
+                sourceY2 = std::min(std::max(0, sourceY2), height - 1);
+
+                // Keep source rectangle coordinates in order.
+                if (sourceX > sourceX2)
+                {
+                    std::swap(sourceX, sourceX2);
+                }
+                if (sourceY > sourceY2)
+                {
+                    std::swap(sourceY, sourceY2);
+                }
+
+                int sourceWidth = sourceX2 - sourceX + 1;
+                int sourceHeight = sourceY2 - sourceY + 1;
+                int scaledWidth = int(scaleX * sourceWidth);
+                int scaledHeight = int(scaleY * sourceHeight);
+                if(scaledWidth <= 0 || scaledHeight <= 0)
+                {
+                    return;
+                }
+
+                int destX2 = destX + scaledWidth - 1;
+                int destY2 = destY + scaledHeight - 1;
+                // 16.16 fixed-point source step per dest pixel, for the filters.
+                int fixedStepX = int(std::floor(double(sourceWidth) * 65536.0 / scaledWidth + 0.5));
+                int fixedStepY = int(std::floor(double(sourceHeight) * 65536.0 / scaledHeight + 0.5));
+
+                // Don't draw if completely outside clipping regions.
+                if(destX > dest->clipX2 || destX2 < dest->clipX || destY > dest->clipY2 || destY2 < dest->clipY)
+                {
+                    return;
+                }
+                // Keep sample rectangle inside clipping regions.
+                int sampleX = std::max(dest->clipX - destX, 0);
+                int sampleY = std::max(dest->clipY - destY, 0);
+                int sampleX2 = std::min(dest->clipX2 - destX, scaledWidth - 1);
+                int sampleY2 = std::min(dest->clipY2 - destY, scaledHeight - 1);
+
+                dest->modified(destX + sampleX, destY + sampleY, destX + sampleX2, destY + sampleY2);
+
+                if(filter == ScaleNearest)
+                {
+                    // Each dest pixel takes the source pixel under its centre: column j samples
+                    // (2j + 1) * sourceWidth / (2 * scaledWidth), stepped along with a remainder
+                    // so it's exact without dividing for every pixel.
+                    long long divisor = 2LL * scaledWidth;
+                    long long numerator = (2LL * sampleX + 1) * sourceWidth;
+                    int firstColumn = sourceX + int(numerator / divisor);
+                    long long firstRemainder = numerator % divisor;
+                    int columnStep = int(2LL * sourceWidth / divisor);
+                    long long remainderStep = 2LL * sourceWidth % divisor;
+
+                    // Resample each row into a buffer, then blend it as a span.
+                    auto drawRows = [&](int bandY, int bandY2)
+                    {
+                        Color row[SpanBufferSize];
+                        for(int i = bandY; i <= bandY2; i++)
+                        {
+                            const Color* sourceRow = data + (sourceY + int(((2LL * i + 1) * sourceHeight) / (2LL * scaledHeight))) * pitch;
+                            Color* destRow = dest->data + (destY + i) * dest->pitch + destX;
+                            int column = firstColumn;
+                            long long remainder = firstRemainder;
+                            for(int j = sampleX; j <= sampleX2; j += SpanBufferSize)
+                            {
+                                int count = std::min<int>(sampleX2 - j + 1, SpanBufferSize);
+                                for(int k = 0; k < count; k++)
+                                {
+                                    row[k] = sourceRow[column];
+                                    column += columnStep;
+                                    remainder += remainderStep;
+                                    if(remainder >= divisor)
+                                    {
+                                        remainder -= divisor;
+                                        column++;
+                                    }
+                                }
+                                blendSpan(row, destRow + j, count, opacity, f);
+                            }
+                        }
+                    };
+                    if(sharesPixels(dest))
+                    {
+                        drawRows(sampleY, sampleY2);
+                    }
+                    else
+                    {
+                        dest->forEachBand(sampleY, sampleY2, sampleX2 - sampleX + 1, drawRows);
+                    }
+                    return;
+                }
+
+                // Filtered rows: the column taps are shared by every row, and each
+                // band filters source rows along x once, then combines them along y.
+                FilterScratch& scratch = dest->filterScratch;
+                scratch.columns.build(filter, sourceWidth, scaledWidth, fixedStepX, sampleX, sampleX2);
+                scratch.rows.build(filter, sourceHeight, scaledHeight, fixedStepY, sampleY, sampleY2);
+                const Color* sourceStart = data + sourceY * pitch + sourceX;
+                int count = sampleX2 - sampleX + 1;
+                auto drawFilteredRows = [&](int bandY, int bandY2, FilterRowCache& cache)
+                {
+                    cache.reset(sourceStart, pitch, scratch.columns, scratch.rows);
+                    for(int i = bandY; i <= bandY2; i++)
+                    {
+                        blendSpan(cache.getOutputRow(i - sampleY), dest->data + (destY + i) * dest->pitch + destX + sampleX, count, opacity, f);
+                    }
+                };
+
+                // Drawn serially, as most sprites are, the dest's own cache will do. Bands
+                // drawn at once each need their own, but then there are plenty of pixels
+                // to pay for it.
+                if(sharesPixels(dest) || !dest->splitsIntoBands(sampleY2 - sampleY + 1, count))
+                {
+                    drawFilteredRows(sampleY, sampleY2, scratch.cache);
+                }
+                else
+                {
+                    dest->forEachBand(sampleY, sampleY2, count, [&](int bandY, int bandY2)
+                    {
+                        FilterRowCache cache;
+                        drawFilteredRows(bandY, bandY2, cache);
+                    });
+                }
+            }
+
+        public:
+            // Draws the image turned by angle radians (clockwise on screen) about its
+            // centre, which lands on x, y.
+            template<typename BlendFunction> void rotateBlit(int x, int y, double angle, Image* dest, BlendFunction f)
+            {
+                rotateScaleBlitRegion(0, 0, width - 1, height - 1, x, y, angle, 1.0, dest, f);
+            }
+
+            template<typename BlendFunction> void rotateScaleBlit(int x, int y, double angle, double scale, Image* dest, BlendFunction f)
+            {
+                rotateScaleBlitRegion(0, 0, width - 1, height - 1, x, y, angle, scale, dest, f);
+            }
+
+            template<typename BlendFunction> void rotateBlitRegion(int sourceX, int sourceY, int sourceX2, int sourceY2,
+                int destX, int destY, double angle, Image* dest, BlendFunction f)
+            {
+                rotateScaleBlitRegion(sourceX, sourceY, sourceX2, sourceY2, destX, destY, angle, 1.0, dest, f);
+            }
+
+            // Draws the source rectangle turned by angle radians and scaled by scale,
+            // with its centre landing on destX, destY.
+            template<typename BlendFunction> void rotateScaleBlitRegion(int sourceX, int sourceY, int sourceX2, int sourceY2,
+                int destX, int destY, double angle, double scale, Image* dest, BlendFunction f)
+            {
+                if(!(scale > 0))
+                {
+                    return;
+                }
+                double halfWidth = (std::abs(sourceX2 - sourceX) + 1) / 2.0;
+                double halfHeight = (std::abs(sourceY2 - sourceY) + 1) / 2.0;
+                Transform2D transform = Transform2D::translation(-halfWidth, -halfHeight)
+                    .then(Transform2D::scaling(scale, scale))
+                    .then(Transform2D::rotation(angle))
+                    .then(Transform2D::translation(destX, destY));
+                transformDrawRegion(sourceX, sourceY, sourceX2, sourceY2, transform, dest, f);
+            }
+
+            template<typename BlendFunction> void transformDraw(const Transform2D& transform, Image* dest, BlendFunction f)
+            {
+                transformDrawRegion(0, 0, width - 1, height - 1, transform, dest, f);
+            }
+
+            // Draws the source rectangle through an affine transform, which takes points
+            // relative to the rectangle's top left corner to dest. Each dest pixel takes
+            // the source pixel under its centre, so the result doesn't depend on the
+            // clipping. Whole-pixel moves and scales by whole-pixel sizes go through
+            // drawRegion and scaleDrawRegion instead.
+            template<typename BlendFunction> void transformDrawRegion(int sourceX, int sourceY, int sourceX2, int sourceY2,
+                const Transform2D& transform, Image* dest, BlendFunction f)
+            {
+                transformDrawRegionAtOpacity(sourceX, sourceY, sourceX2, sourceY2, transform, dest, opacity, f);
+            }
+
+        private:
+            static bool isWhole(double value)
+            {
+                return value == std::floor(value) && std::abs(value) < (1 << 30);
+            }
+
+            // Reads count source pixels into row, stepping through the source in 16.16
+            // fixed point from u, v, which are left just past the last pixel read.
+            // Every pixel read has to be inside the image.
+            void gatherSpan(Color* row, int count, int& fixedU, int& fixedV, int stepU, int stepV) const
+            {
+                if(stepV == 0)
+                {
+                    const Color* sourceRow = data + (fixedV >> 16) * pitch;
+                    for(int k = 0; k < count; k++, fixedU += stepU)
+                    {
+                        row[k] = sourceRow[fixedU >> 16];
+                    }
+                }
+                else
+                {
+                    for(int k = 0; k < count; k++, fixedU += stepU, fixedV += stepV)
+                    {
+                        row[k] = data[(fixedV >> 16) * pitch + (fixedU >> 16)];
+                    }
+                }
+            }
+
+            template<typename BlendFunction> void transformDrawRegionAtOpacity(int sourceX, int sourceY, int sourceX2, int sourceY2,
+                const Transform2D& transform, Image* dest, ColorChannel opacity, BlendFunction f)
+            {
+                // Ensure that the source coordinates stay inside the image, which
+                // an empty view has none of.
+                if(width == 0 || height == 0)
+                {
+                    return;
+                }
+                sourceX = std::min(std::max(0, sourceX), width - 1);
+                sourceY = std::min(std::max(0, sourceY), height - 1);
+                sourceX2 = std::min(std::max(0, sourceX2), width - 1);
+                sourceY2 = std::min(std::max(0, sourceY2), height - 1);
+
+                // Keep source rectangle coordinates in order.
+                if (sourceX > sourceX2)
+                {
+                    std::swap(sourceX, sourceX2);
+                }
+                if (sourceY > sourceY2)
+                {
+                    std::swap(sourceY, sourceY2);
+                }
+
+                int sourceWidth = sourceX2 - sourceX + 1;
+                int sourceHeight = sourceY2 - sourceY + 1;
+                if(!transform.isInvertible() || (BlendTraits<BlendFunction>::SkipsTransparent && getAlphaClass() == AlphaTransparent))
+                {
+                    return;
+                }
+
+                // Moves and scales that keep pixels lined up with the grid have their own paths,
+                // which also take the source pixel under each dest pixel's centre, so they
+                // draw the same pixels the general path below would.
+                if(transform.isAxisAligned() && isWhole(transform.tx) && isWhole(transform.ty))
+                {
+                    if(transform.a == 1 && transform.d == 1)
+                    {
+                        drawRegionAtOpacity(sourceX, sourceY, sourceX2, sourceY2, int(transform.tx), int(transform.ty), dest, opacity, f);
+                        return;
+                    }
+                    if(transform.a > 0 && transform.d > 0 && isWhole(transform.a * sourceWidth) && isWhole(transform.d * sourceHeight))
+                    {
+                        scaleDrawRegionAtOpacity(sourceX, sourceY, sourceX2, sourceY2, int(transform.tx), int(transform.ty),
+                            transform.a, transform.d, dest, opacity, f, ScaleNearest);
+                        return;
+                    }
+                }
+
+                // One step right in dest is this far across and down the source.
+                Transform2D inverse = transform.inverted();
+                double stepUX = inverse.a;
+                double stepVX = inverse.b;
+                // Anything this small is well under a pixel, and the steps wouldn't fit in 16.16.
+                if(std::abs(stepUX) >= 32768 || std::abs(stepVX) >= 32768)
+                {
+                    return;
+                }
+
+                // The transformed rectangle's bounding scanlines, cut down to the clipping region.
+                double cornerX[4], cornerY[4];
+                transform.apply(0, 0, cornerX[0], cornerY[0]);
+                transform.apply(sourceWidth, 0, cornerX[1], cornerY[1]);
+                transform.apply(0, sourceHeight, cornerX[2], cornerY[2]);
+                transform.apply(sourceWidth, sourceHeight, cornerX[3], cornerY[3]);
+                double boundsX = *std::min_element(cornerX, cornerX + 4);
+                double boundsY = *std::min_element(cornerY, cornerY + 4);
+                double boundsX2 = *std::max_element(cornerX, cornerX + 4);
+                double boundsY2 = *std::max_element(cornerY, cornerY + 4);
+                if(boundsX > dest->clipX2 + 1 || boundsX2 < dest->clipX || boundsY > dest->clipY2 + 1 || boundsY2 < dest->clipY)
+                {
+                    return;
+                }
+                int x = int(std::max(std::floor(boundsX), double(dest->clipX)));
+                int y = int(std::max(std::floor(boundsY), double(dest->clipY)));
+                int x2 = int(std::min(std::ceil(boundsX2), double(dest->clipX2)));
+                int y2 = int(std::min(std::ceil(boundsY2), double(dest->clipY2)));
+                // Fixed-point stepping starts from here on every scanline, so clipping
+                // doesn't change which pixels get sampled.
+                int anchorX = int(std::max(std::floor(boundsX), double(dest->clipX - (1 << 20))));
+
+                // 16.16 fixed-point source steps per dest pixel, and the source rectangle's edges.
+                int fixedStepUX = int(std::floor(stepUX * 65536.0 + 0.5));
+                int fixedStepVX = int(std::floor(stepVX * 65536.0 + 0.5));
+                long long fixedLeft = (long long) sourceX << 16;
+                long long fixedTop = (long long) sourceY << 16;
+                long long fixedRight = (long long) (sourceX2 + 1) << 16;
+                long long fixedBottom = (long long) (sourceY2 + 1) << 16;
+
+                // Finds scanline i's span, and where in the source it starts. It's cheap
+                // enough to work out twice, once for the bounds and once to draw, which
+                // saves keeping every span.
+                auto findSpan = [&](int i, int& first, int& last, int& spanU, int& spanV)
+                {
+                    // Source position under the centre of dest pixel x on this scanline,
+                    // as u0 + x * stepUX, v0 + x * stepVX.
+                    double u0 = sourceX + inverse.a * 0.5 + inverse.c * (i + 0.5) + inverse.tx;
+                    double v0 = sourceY + inverse.b * 0.5 + inverse.d * (i + 0.5) + inverse.ty;
+
+                    // Cut the scanline down to where it crosses the source rectangle.
+                    double low = x;
+                    double high = x2 + 1;
+                    clipSpanToSlab(u0, stepUX, sourceX, sourceX2 + 1, low, high);
+                    clipSpanToSlab(v0, stepVX, sourceY, sourceY2 + 1, low, high);
+                    first = int(std::max(std::ceil(low - 0.5) - 1, double(x)));
+                    last = int(std::min(std::floor(high + 0.5), double(x2)));
+
+                    // Trim the ends in fixed point until both land inside the source
+                    // rectangle, so nothing in between can miss.
+                    long long fixedU = (long long) std::floor((u0 + anchorX * stepUX) * 65536.0) + (long long) (first - anchorX) * fixedStepUX;
+                    long long fixedV = (long long) std::floor((v0 + anchorX * stepVX) * 65536.0) + (long long) (first - anchorX) * fixedStepVX;
+                    while(first <= last && !fixedInside(fixedU, fixedV, fixedLeft, fixedTop, fixedRight, fixedBottom))
+                    {
+                        first++;
+                        fixedU += fixedStepUX;
+                        fixedV += fixedStepVX;
+                    }
+                    while(first <= last && !fixedInside(fixedU + (long long) (last - first) * fixedStepUX, fixedV + (long long) (last - first) * fixedStepVX,
+                        fixedLeft, fixedTop, fixedRight, fixedBottom))
+                    {
+                        last--;
+                    }
+                    spanU = int(fixedU);
+                    spanV = int(fixedV);
+                };
+
+                int minX = x2 + 1;
+                int maxX = x - 1;
+                int minY = y2 + 1;
+                int maxY = y - 1;
+                for(int i = y; i <= y2; i++)
+                {
+                    int first, last, fixedU, fixedV;
+                    findSpan(i, first, last, fixedU, fixedV);
+                    if(first <= last)
+                    {
+                        minX = std::min(minX, first);
+                        maxX = std::max(maxX, last);
+                        minY = std::min(minY, i);
+                        maxY = std::max(maxY, i);
+                    }
+                }
+                if(minX > maxX)
+                {
+                    return;
+                }
+                dest->modified(minX, minY, maxX, maxY);
+
+                // Gather each span into a buffer, then blend it.
+                auto drawRows = [&](int bandY, int bandY2)
+                {
+                    Color row[SpanBufferSize];
+                    for(int i = bandY; i <= bandY2; i++)
+                    {
+                        int first, last, fixedU, fixedV;
+                        findSpan(i, first, last, fixedU, fixedV);
+                        Color* destRow = dest->data + i * dest->pitch;
+                        for(int j = first; j <= last; j += SpanBufferSize)
+                        {
+                            int count = std::min<int>(last - j + 1, SpanBufferSize);
+                            gatherSpan(row, count, fixedU, fixedV, fixedStepUX, fixedStepVX);
+                            blendSpan(row, destRow + j, count, opacity, f);
+                        }
+                    }
+                };
+                if(sharesPixels(dest))
+                {
+                    drawRows(minY, maxY);
+                }
+                else
+                {
+                    dest->forEachBand(minY, maxY, maxX - minX + 1, drawRows);
+                }
+            }
+
+            // Narrows low..high to the xs where start + x * step lies in min..max.
+            static void clipSpanToSlab(double start, double step, double min, double max, double& low, double& high)
+            {
+                if(step == 0)
+                {
+                    if(start < min || start >= max)
+                    {
+                        high = low;
+                    }
+                    return;
+                }
+                double enter = (min - start) / step;
+                double leave = (max - start) / step;
+                if(enter > leave)
+                {
+                    std::swap(enter, leave);
+                }
+                low = std::max(low, enter);
+                high = std::min(high, leave);
+            }
+
+            static bool fixedInside(long long u, long long v, long long left, long long top, long long right, long long bottom)
+            {
+                return u >= left && u < right && v >= top && v < bottom;
+            }
+    };
+
+    // A rectangle of another image's pixels, used in place without copying them:
+    // a frame of a sprite sheet, or a viewport to draw into. It's an Image, so
+    // anything that draws from or onto an Image works with a view, clipped to it.
+    //
+    // Writes through a view mark the parent dirty. The parent has to outlive
+    // its views, and its pixels can't be reallocated while they're in use.
+    class ImageView : public Image
+    {
+        public:
+            ImageView(Image* parent, int x, int y, int x2, int y2):
+                Image(parent, x, y, x2, y2)
+            {
+            }
+    };
+}
+
 #endif
\ No newline at end of file
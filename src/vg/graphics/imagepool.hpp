@@ -0,0 +1,184 @@
+#ifndef VG_GRAPHICS_IMAGEPOOL_HPP
+#define VG_GRAPHICS_IMAGEPOOL_HPP
+
+#include <vector>
+#include <algorithm>
+#include "color.hpp"
+#include "image.hpp"
+
+namespace vg
+{
+    // Hands out scratch Images for effects and composition, and takes them back
+    // to reuse their pixel buffers, so a steady stream of same-sized temporary
+    // surfaces doesn't allocate once the pool has warmed up.
+    //
+    // Buffers are kept in size classes of powers of two pixels, and a released
+    // image can come back at any size that fits its class. Cleared images are
+    // cleared lazily: an image that comes back at the same size and colour it
+    // was last cleared to only has the area written since cleared again.
+    class ImagePool
+    {
+        private:
+            struct Surface
+            {
+                Image* image;
+                // Whether the pixels outside image->touched are all clearColor.
+                bool clean;
+                Color clearColor;
+            };
+
+            // Free surfaces, indexed by size class.
+            std::vector<std::vector<Surface> > freeSurfaces;
+            // What each image handed out was last cleared to, for when it comes back.
+            std::vector<Surface> usedSurfaces;
+            size_t allocatedBytes;
+            size_t highWaterBytes;
+
+            static int getSizeClass(int pixels)
+            {
+                int sizeClass = 0;
+                while((1 << sizeClass) < pixels)
+                {
+                    sizeClass++;
+                }
+                return sizeClass;
+            }
+
+            static size_t getBytes(const Image* image)
+            {
+                return (image->capacity + Image::RowAlignmentPixels - 1) * sizeof(Color);
+            }
+
+            Surface take(int width, int height, bool clear, Color clearColor)
+            {
+                int sizeClass = getSizeClass(Image::getAlignedPitch(width) * height);
+                if(sizeClass >= int(freeSurfaces.size()))
+                {
+                    freeSurfaces.resize(sizeClass + 1);
+                }
+
+                std::vector<Surface>& candidates = freeSurfaces[sizeClass];
+                if(candidates.empty())
+                {
+                    Surface surface = {new Image(width, height, 1 << sizeClass), false, ColorBlack};
+                    allocatedBytes += getBytes(surface.image);
+                    highWaterBytes = std::max(highWaterBytes, allocatedBytes);
+                    return surface;
+                }
+
+                // Prefer one that's already clear at this size, then any of them.
+                size_t best = candidates.size() - 1;
+                for(size_t i = 0; i < candidates.size(); i++)
+                {
+                    const Surface& candidate = candidates[i];
+                    if(clear && candidate.clean && candidate.clearColor == clearColor
+                        && candidate.image->width == width && candidate.image->height == height)
+                    {
+                        best = i;
+                        break;
+                    }
+                }
+                Surface surface = candidates[best];
+                candidates[best] = candidates.back();
+                candidates.pop_back();
+                return surface;
+            }
+
+        public:
+            ImagePool():
+                allocatedBytes(0),
+                highWaterBytes(0)
+            {
+            }
+
+            // Images still handed out when the pool goes away are left to their users.
+            ~ImagePool()
+            {
+                trim();
+            }
+
+            // An image of the given size, with whatever pixels it had last.
+            Image* acquireUninitialized(int width, int height)
+            {
+                Surface surface = take(width, height, false, ColorBlack);
+                surface.image->reshape(width, height);
+                surface.clean = false;
+                usedSurfaces.push_back(surface);
+                return surface.image;
+            }
+
+            // An image of the given size, filled with color.
+            Image* acquire(int width, int height, Color color)
+            {
+                Surface surface = take(width, height, true, color);
+                Image* image = surface.image;
+                DirtyRect touched = image->touched;
+                bool reusable = surface.clean && surface.clearColor == color && image->width == width && image->height == height;
+                image->reshape(width, height);
+                if(!reusable)
+                {
+                    image->clear(color);
+                }
+                else if(touched.x <= touched.x2)
+                {
+                    image->rectFill(touched.x, touched.y, touched.x2, touched.y2, color, CopyBlender());
+                }
+                image->clearDirtyRects();
+                image->resetTouched();
+
+                surface.clean = true;
+                surface.clearColor = color;
+                usedSurfaces.push_back(surface);
+                return image;
+            }
+
+            // Hands an image from acquire back for reuse. The caller can't touch it after.
+            void release(Image* image)
+            {
+                for(size_t i = 0; i < usedSurfaces.size(); i++)
+                {
+                    if(usedSurfaces[i].image == image)
+                    {
+                        Surface surface = usedSurfaces[i];
+                        usedSurfaces[i] = usedSurfaces.back();
+                        usedSurfaces.pop_back();
+                        freeSurfaces[getSizeClass(image->capacity)].push_back(surface);
+                        return;
+                    }
+                }
+            }
+
+            // Frees every buffer not handed out right now.
+            void trim()
+            {
+                for(size_t i = 0; i < freeSurfaces.size(); i++)
+                {
+                    for(size_t j = 0; j < freeSurfaces[i].size(); j++)
+                    {
+                        allocatedBytes -= getBytes(freeSurfaces[i][j].image);
+                        delete freeSurfaces[i][j].image;
+                    }
+                    freeSurfaces[i].clear();
+                }
+            }
+
+            // Bytes of pixel buffers the pool owns, handed out or not.
+            size_t getAllocatedBytes() const
+            {
+                return allocatedBytes;
+            }
+
+            // The most getAllocatedBytes() has ever been, for sizing budgets.
+            size_t getHighWaterBytes() const
+            {
+                return highWaterBytes;
+            }
+
+            int getUsedCount() const
+            {
+                return int(usedSurfaces.size());
+            }
+    };
+}
+
+#endif
\ No newline at end of file
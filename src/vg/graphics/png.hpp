@@ -0,0 +1,652 @@
+#ifndef VG_GRAPHICS_PNG_HPP
+#define VG_GRAPHICS_PNG_HPP
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <zlib/zlib.h>
+#include "color.hpp"
+#include "simd.hpp"
+#include "image.hpp"
+
+namespace vg
+{
+    // Loads 8-bit PNG images: greyscale, grey with alpha, RGB, RGBA and paletted,
+    // with tRNS transparency. Interlaced images and other bit depths aren't supported.
+    // Returns null if the image can't be loaded, or a new Image the caller owns,
+    // with straight (not premultiplied) alpha.
+    //
+    // Scanlines are inflated straight into the image's rows, and filters undone
+    // in place, against the row above while it still holds its raw bytes. Each row
+    // is widened to Colors only once the row below it is done with it. So besides
+    // the image, the only memory used is zlib's window and one input buffer.
+    // The Up, Sub, Avg and Paeth filters use SSE2 where there is a whole RGB or
+    // RGBA pixel to work on.
+    class PngDecoder
+    {
+        private:
+            enum { ColorGrey = 0, ColorRgb = 2, ColorPalette = 3, ColorGreyAlpha = 4, ColorRgba = 6 };
+            enum { FilterNone = 0, FilterSub = 1, FilterUp = 2, FilterAverage = 3, FilterPaeth = 4 };
+            // How much compressed data is read from a file at a time.
+            enum { InputBufferSize = 64 * 1024 };
+            // Larger images are refused outright, rather than trusting the header.
+            enum { MaxPixels = 1 << 28 };
+
+            // Input comes from a file, or from memory when file is null.
+            FILE* file;
+            const unsigned char* memory;
+            size_t memorySize;
+            size_t memoryOffset;
+            std::vector<unsigned char> inputBuffer;
+
+            int width, height;
+            int colorType;
+            // Bytes per pixel, before widening to Colors.
+            int channels;
+            Color palette[256];
+            int paletteSize;
+            // The tRNS colour for greyscale and RGB images, as R, G, B.
+            bool hasColorKey;
+            unsigned char colorKey[3];
+            // Bytes left in the IDAT chunk being inflated.
+            unsigned int chunkRemaining;
+
+            PngDecoder(FILE* file, const unsigned char* memory, size_t memorySize):
+                file(file),
+                memory(memory),
+                memorySize(memorySize),
+                memoryOffset(0),
+                width(0),
+                height(0),
+                colorType(0),
+                channels(0),
+                paletteSize(0),
+                hasColorKey(false),
+                chunkRemaining(0)
+            {
+            }
+
+            // Points at the next size bytes of input, reading them into the input buffer from a file.
+            const unsigned char* fetch(size_t size)
+            {
+                if(file)
+                {
+                    if(inputBuffer.size() < size)
+                    {
+                        inputBuffer.resize(size);
+                    }
+                    return size == 0 || fread(&inputBuffer[0], 1, size, file) == size ? &inputBuffer[0] : 0;
+                }
+                if(memorySize - memoryOffset < size)
+                {
+                    return 0;
+                }
+                const unsigned char* result = memory + memoryOffset;
+                memoryOffset += size;
+                return result;
+            }
+
+            bool skip(size_t size)
+            {
+                if(file)
+                {
+                    return fseek(file, long(size), SEEK_CUR) == 0;
+                }
+                if(memorySize - memoryOffset < size)
+                {
+                    return false;
+                }
+                memoryOffset += size;
+                return true;
+            }
+
+            static unsigned int readBigEndian(const unsigned char* p)
+            {
+                return (unsigned int) p[0] << 24 | (unsigned int) p[1] << 16 | (unsigned int) p[2] << 8 | p[3];
+            }
+
+            static bool isChunk(const unsigned char* type, const char* name)
+            {
+                return std::memcmp(type, name, 4) == 0;
+            }
+
+            // Reads a chunk's length and four letter type.
+            bool readChunkHeader(unsigned int& length, unsigned char* type)
+            {
+                const unsigned char* header = fetch(8);
+                if(!header)
+                {
+                    return false;
+                }
+                length = readBigEndian(header);
+                std::memcpy(type, header + 4, 4);
+                return length <= 0x7FFFFFFF;
+            }
+
+            bool readHeader(const unsigned char* data)
+            {
+                width = int(readBigEndian(data));
+                height = int(readBigEndian(data + 4));
+                int bitDepth = data[8];
+                colorType = data[9];
+                // Compression, filter method and interlacing, in that order.
+                if(bitDepth != 8 || data[10] != 0 || data[11] != 0 || data[12] != 0)
+                {
+                    return false;
+                }
+                if(width <= 0 || height <= 0 || (long long) width * height > MaxPixels)
+                {
+                    return false;
+                }
+                switch(colorType)
+                {
+                    case ColorGrey: channels = 1; break;
+                    case ColorRgb: channels = 3; break;
+                    case ColorPalette: channels = 1; break;
+                    case ColorGreyAlpha: channels = 2; break;
+                    case ColorRgba: channels = 4; break;
+                    default: return false;
+                }
+                return true;
+            }
+
+            bool readPalette(const unsigned char* data, unsigned int length)
+            {
+                if(length % 3 != 0 || length / 3 > 256 || length == 0)
+                {
+                    return false;
+                }
+                paletteSize = int(length / 3);
+                for(int i = 0; i < paletteSize; i++)
+                {
+                    palette[i] = Color(data[i * 3], data[i * 3 + 1], data[i * 3 + 2]);
+                }
+                return true;
+            }
+
+            bool readTransparency(const unsigned char* data, unsigned int length)
+            {
+                switch(colorType)
+                {
+                    case ColorPalette:
+                        if(int(length) > paletteSize)
+                        {
+                            return false;
+                        }
+                        for(unsigned int i = 0; i < length; i++)
+                        {
+                            palette[i][AlphaChannel] = data[i];
+                        }
+                        return true;
+                    // Samples are 16 bits even at 8-bit depth, so the low byte is the key.
+                    case ColorGrey:
+                        if(length != 2)
+                        {
+                            return false;
+                        }
+                        colorKey[0] = colorKey[1] = colorKey[2] = data[1];
+                        hasColorKey = data[0] == 0;
+                        return true;
+                    case ColorRgb:
+                        if(length != 6)
+                        {
+                            return false;
+                        }
+                        colorKey[0] = data[1];
+                        colorKey[1] = data[3];
+                        colorKey[2] = data[5];
+                        hasColorKey = data[0] == 0 && data[2] == 0 && data[4] == 0;
+                        return true;
+                    default:
+                        return false;
+                }
+            }
+
+            // Hands zlib the next piece of image data, moving on to the next IDAT chunk when this one runs out.
+            bool fetchImageData(z_stream& stream)
+            {
+                while(chunkRemaining == 0)
+                {
+                    unsigned int length;
+                    unsigned char type[4];
+                    // Skip the CRC of the chunk before.
+                    if(!skip(4) || !readChunkHeader(length, type) || !isChunk(type, "IDAT"))
+                    {
+                        return false;
+                    }
+                    chunkRemaining = length;
+                }
+                unsigned int size = std::min(chunkRemaining, (unsigned int) InputBufferSize);
+                const unsigned char* data = fetch(size);
+                if(!data)
+                {
+                    return false;
+                }
+                stream.next_in = (Bytef*) data;
+                stream.avail_in = size;
+                chunkRemaining -= size;
+                return true;
+            }
+
+            // Inflates exactly size bytes into dest.
+            bool inflateInto(z_stream& stream, unsigned char* dest, unsigned int size)
+            {
+                stream.next_out = dest;
+                stream.avail_out = size;
+                while(stream.avail_out > 0)
+                {
+                    if(stream.avail_in == 0 && !fetchImageData(stream))
+                    {
+                        return false;
+                    }
+                    int result = inflate(&stream, Z_NO_FLUSH);
+                    if(result == Z_STREAM_END)
+                    {
+                        return stream.avail_out == 0;
+                    }
+                    if(result != Z_OK && result != Z_BUF_ERROR)
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            static int paeth(int a, int b, int c)
+            {
+                int pa = std::abs(b - c);
+                int pb = std::abs(a - c);
+                int pc = std::abs(a + b - 2 * c);
+                return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+            }
+
+#ifdef VG_SSE2
+            // The Avg and Paeth filters depend on the pixel just reconstructed, so
+            // these go a pixel at a time, with its channels side by side in one register.
+
+            // Three byte pixels are put together a byte at a time, since going through
+            // memory with a partial copy stalls the load that follows.
+            template<int Bytes> static __m128i loadPixel(const unsigned char* p)
+            {
+                int value;
+                if(Bytes == 4)
+                {
+                    std::memcpy(&value, p, 4);
+                }
+                else
+                {
+                    value = p[0] | p[1] << 8 | p[2] << 16;
+                }
+                return _mm_cvtsi32_si128(value);
+            }
+
+            template<int Bytes> static void storePixel(unsigned char* p, __m128i pixel)
+            {
+                int value = _mm_cvtsi128_si32(pixel);
+                if(Bytes == 4)
+                {
+                    std::memcpy(p, &value, 4);
+                }
+                else
+                {
+                    p[0] = (unsigned char) value;
+                    p[1] = (unsigned char) (value >> 8);
+                    p[2] = (unsigned char) (value >> 16);
+                }
+            }
+
+            template<int Bytes> static void unfilterSubVectors(unsigned char* row, int length)
+            {
+                __m128i a = _mm_setzero_si128();
+                for(int i = 0; i < length; i += Bytes)
+                {
+                    a = _mm_add_epi8(loadPixel<Bytes>(row + i), a);
+                    storePixel<Bytes>(row + i, a);
+                }
+            }
+
+            template<int Bytes> static void unfilterAverageVectors(unsigned char* row, const unsigned char* prior, int length)
+            {
+                // _mm_avg_epu8 rounds up, so take the low bit of a + b back off to round down.
+                __m128i one = _mm_set1_epi8(1);
+                __m128i a = _mm_setzero_si128();
+                for(int i = 0; i < length; i += Bytes)
+                {
+                    __m128i b = loadPixel<Bytes>(prior + i);
+                    __m128i x = loadPixel<Bytes>(row + i);
+                    __m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+                    a = _mm_add_epi8(x, average);
+                    storePixel<Bytes>(row + i, a);
+                }
+            }
+
+            template<int Bytes> static void unfilterPaethVectors(unsigned char* row, const unsigned char* prior, int length)
+            {
+                // Paeth needs the differences, so channels are widened to 16-bit lanes.
+                __m128i zero = _mm_setzero_si128();
+                __m128i a = zero;
+                __m128i c = zero;
+                for(int i = 0; i < length; i += Bytes)
+                {
+                    __m128i b = _mm_unpacklo_epi8(loadPixel<Bytes>(prior + i), zero);
+                    __m128i x = loadPixel<Bytes>(row + i);
+                    // pa = |b - c|, pb = |a - c|, pc = |a + b - 2c|, using the signed sums before taking the absolute value.
+                    __m128i pa = _mm_sub_epi16(b, c);
+                    __m128i pb = _mm_sub_epi16(a, c);
+                    __m128i pc = _mm_add_epi16(pa, pb);
+                    pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+                    pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+                    pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+                    __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+                    // Pick c, then b over it, then a over both, for the ties to go the standard's way.
+                    __m128i useB = _mm_cmpeq_epi16(pb, smallest);
+                    __m128i useA = _mm_cmpeq_epi16(pa, smallest);
+                    __m128i predictor = _mm_or_si128(_mm_and_si128(useB, b), _mm_andnot_si128(useB, c));
+                    predictor = _mm_or_si128(_mm_and_si128(useA, a), _mm_andnot_si128(useA, predictor));
+                    c = b;
+                    x = _mm_add_epi8(x, _mm_packus_epi16(predictor, predictor));
+                    storePixel<Bytes>(row + i, x);
+                    a = _mm_unpacklo_epi8(x, zero);
+                }
+            }
+#endif
+
+            // Undoes one row's filter in place. Prior is the row above, already
+            // reconstructed, or null for the first row, which counts as zeros.
+            static bool unfilterRow(int filter, unsigned char* row, const unsigned char* prior, int length, int bytes)
+            {
+                switch(filter)
+                {
+                    case FilterNone:
+                        return true;
+
+                    case FilterSub:
+#ifdef VG_SSE2
+                        if(bytes >= 3)
+                        {
+                            bytes == 3 ? unfilterSubVectors<3>(row, length) : unfilterSubVectors<4>(row, length);
+                            return true;
+                        }
+#endif
+                        for(int i = bytes; i < length; i++)
+                        {
+                            row[i] = (unsigned char) (row[i] + row[i - bytes]);
+                        }
+                        return true;
+
+                    case FilterUp:
+                    {
+                        if(!prior)
+                        {
+                            return true;
+                        }
+                        int i = 0;
+#ifdef VG_SSE2
+                        for(; i + 16 <= length; i += 16)
+                        {
+                            __m128i x = _mm_loadu_si128((const __m128i*) (row + i));
+                            __m128i b = _mm_loadu_si128((const __m128i*) (prior + i));
+                            _mm_storeu_si128((__m128i*) (row + i), _mm_add_epi8(x, b));
+                        }
+#endif
+                        for(; i < length; i++)
+                        {
+                            row[i] = (unsigned char) (row[i] + prior[i]);
+                        }
+                        return true;
+                    }
+
+                    case FilterAverage:
+                        if(!prior)
+                        {
+                            for(int i = bytes; i < length; i++)
+                            {
+                                row[i] = (unsigned char) (row[i] + (row[i - bytes] >> 1));
+                            }
+                            return true;
+                        }
+#ifdef VG_SSE2
+                        if(bytes >= 3)
+                        {
+                            bytes == 3 ? unfilterAverageVectors<3>(row, prior, length) : unfilterAverageVectors<4>(row, prior, length);
+                            return true;
+                        }
+#endif
+                        for(int i = 0; i < bytes; i++)
+                        {
+                            row[i] = (unsigned char) (row[i] + (prior[i] >> 1));
+                        }
+                        for(int i = bytes; i < length; i++)
+                        {
+                            row[i] = (unsigned char) (row[i] + ((row[i - bytes] + prior[i]) >> 1));
+                        }
+                        return true;
+
+                    case FilterPaeth:
+                        // With nothing above, Paeth always predicts from the left, as Sub does.
+                        if(!prior)
+                        {
+                            return unfilterRow(FilterSub, row, prior, length, bytes);
+                        }
+#ifdef VG_SSE2
+                        if(bytes >= 3)
+                        {
+                            bytes == 3 ? unfilterPaethVectors<3>(row, prior, length) : unfilterPaethVectors<4>(row, prior, length);
+                            return true;
+                        }
+#endif
+                        for(int i = 0; i < bytes; i++)
+                        {
+                            row[i] = (unsigned char) (row[i] + prior[i]);
+                        }
+                        for(int i = bytes; i < length; i++)
+                        {
+                            row[i] = (unsigned char) (row[i] + paeth(row[i - bytes], prior[i], prior[i - bytes]));
+                        }
+                        return true;
+
+                    default:
+                        return false;
+                }
+            }
+
+            // Widens a reconstructed row to Colors, in place. Pixels are widened
+            // right to left, so none is overwritten before it's read.
+            void convertRow(unsigned char* row) const
+            {
+                Color* pixels = (Color*) row;
+                int x = width - 1;
+                switch(colorType)
+                {
+                    case ColorRgba:
+                    {
+                        // Already four bytes a pixel; just swap red and blue into place.
+                        x = 0;
+#ifdef VG_SSE2
+                        __m128i keep = _mm_set1_epi32(0xFF00FF00);
+                        __m128i low = _mm_set1_epi32(0xFF);
+                        for(; x + 4 <= width; x += 4)
+                        {
+                            __m128i v = _mm_loadu_si128((const __m128i*) (pixels + x));
+                            __m128i red = _mm_and_si128(_mm_srli_epi32(v, 16), low);
+                            __m128i blue = _mm_slli_epi32(_mm_and_si128(v, low), 16);
+                            _mm_storeu_si128((__m128i*) (pixels + x), _mm_or_si128(_mm_and_si128(v, keep), _mm_or_si128(red, blue)));
+                        }
+#endif
+                        for(; x < width; x++)
+                        {
+                            std::swap(row[x * 4], row[x * 4 + 2]);
+                        }
+                        break;
+                    }
+
+                    case ColorRgb:
+                        for(; x >= 0; x--)
+                        {
+                            const unsigned char* p = row + x * 3;
+                            pixels[x] = Color(p[0], p[1], p[2],
+                                hasColorKey && p[0] == colorKey[0] && p[1] == colorKey[1] && p[2] == colorKey[2] ? 0 : 255);
+                        }
+                        break;
+
+                    case ColorGreyAlpha:
+                        for(; x >= 0; x--)
+                        {
+                            const unsigned char* p = row + x * 2;
+                            pixels[x] = Color(p[0], p[0], p[0], p[1]);
+                        }
+                        break;
+
+                    case ColorGrey:
+                        for(; x >= 0; x--)
+                        {
+                            int grey = row[x];
+                            pixels[x] = Color(grey, grey, grey, hasColorKey && grey == colorKey[0] ? 0 : 255);
+                        }
+                        break;
+
+                    case ColorPalette:
+                        for(; x >= 0; x--)
+                        {
+                            // Out of range indices are an error in the file; show them as transparent.
+                            int index = row[x];
+                            pixels[x] = index < paletteSize ? palette[index] : Color(0u);
+                        }
+                        break;
+                }
+            }
+
+            // Inflates and reconstructs every row into a new image, with the first IDAT chunk's length already read.
+            Image* readImage()
+            {
+                z_stream stream;
+                std::memset(&stream, 0, sizeof(stream));
+                if(inflateInit(&stream) != Z_OK)
+                {
+                    return 0;
+                }
+
+                // No need to clear the pixels, since every row gets written.
+                Image* image = new Image(width, height, 0);
+                unsigned char* pixels = (unsigned char*) image->getRawData(0, 0, width - 1, height - 1);
+                size_t pitch = size_t(image->getPitch()) * sizeof(Color);
+                int length = width * channels;
+                bool success = true;
+                for(int y = 0; y < height && success; y++)
+                {
+                    unsigned char* row = pixels + y * pitch;
+                    unsigned char* prior = y > 0 ? row - pitch : 0;
+                    unsigned char filter;
+                    success = inflateInto(stream, &filter, 1)
+                        && inflateInto(stream, row, length)
+                        && unfilterRow(filter, row, prior, length, channels);
+                    // The row above has served as the prior row, so it can be widened now.
+                    if(success && prior)
+                    {
+                        convertRow(prior);
+                    }
+                }
+                inflateEnd(&stream);
+
+                if(!success)
+                {
+                    delete image;
+                    return 0;
+                }
+                convertRow(pixels + (height - 1) * pitch);
+                return image;
+            }
+
+            Image* decode()
+            {
+                static const unsigned char signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+                const unsigned char* data = fetch(8);
+                if(!data || std::memcmp(data, signature, 8) != 0)
+                {
+                    return 0;
+                }
+
+                // IHDR comes first, then anything up to the first IDAT chunk.
+                bool first = true;
+                bool hasPalette = false;
+                while(true)
+                {
+                    unsigned int length;
+                    unsigned char type[4];
+                    if(!readChunkHeader(length, type) || first != isChunk(type, "IHDR"))
+                    {
+                        return 0;
+                    }
+                    first = false;
+
+                    if(isChunk(type, "IDAT"))
+                    {
+                        if(colorType == ColorPalette && !hasPalette)
+                        {
+                            return 0;
+                        }
+                        chunkRemaining = length;
+                        return readImage();
+                    }
+                    else if(isChunk(type, "IHDR") || isChunk(type, "PLTE") || isChunk(type, "tRNS"))
+                    {
+                        // None of these is bigger than a full palette.
+                        data = length <= 768 ? fetch(length) : 0;
+                        if(!data)
+                        {
+                            return 0;
+                        }
+                        bool valid = true;
+                        if(isChunk(type, "IHDR"))
+                        {
+                            valid = length == 13 && readHeader(data);
+                        }
+                        else if(isChunk(type, "PLTE"))
+                        {
+                            // Greyscale images can't have palettes, and others can only use them as hints.
+                            valid = colorType != ColorGrey && colorType != ColorGreyAlpha && readPalette(data, length);
+                            hasPalette = valid;
+                        }
+                        else
+                        {
+                            valid = readTransparency(data, length);
+                        }
+                        if(!valid || !skip(4))
+                        {
+                            return 0;
+                        }
+                    }
+                    // Critical chunks we don't know about (a capital first letter) mean the image can't be shown right.
+                    else if(isChunk(type, "IEND") || (type[0] & 0x20) == 0 || !skip(size_t(length) + 4))
+                    {
+                        return 0;
+                    }
+                }
+            }
+
+        public:
+            static Image* load(const char* filename)
+            {
+                FILE* file = fopen(filename, "rb");
+                if(!file)
+                {
+                    return 0;
+                }
+                PngDecoder decoder(file, 0, 0);
+                Image* image = decoder.decode();
+                fclose(file);
+                return image;
+            }
+
+            // Loads a PNG file already in memory.
+            static Image* load(const void* data, size_t size)
+            {
+                PngDecoder decoder(0, (const unsigned char*) data, size);
+                return decoder.decode();
+            }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,141 @@
+#ifndef VG_GRAPHICS_POLYGON_HPP
+#define VG_GRAPHICS_POLYGON_HPP
+
+#include <vector>
+#include <algorithm>
+
+namespace vg
+{
+    // One non-horizontal polygon edge, walked down a scanline at a time.
+    struct PolygonEdge
+    {
+        // First scanline the edge crosses, and one past the last.
+        int y, y2;
+        // Where the edge crosses the current scanline's centre, and the change
+        // per scanline, in 16.16 fixed point. Wide, so points far outside the
+        // clip don't overflow.
+        long long fixedX, fixedStep;
+
+        bool operator<(const PolygonEdge& other) const
+        {
+            return y < other.y;
+        }
+    };
+
+    // Fills a polygon a scanline at a time, calling span(y, x, x2) for each run of
+    // pixels inside it, clipped to clipX, clipY - clipX2, clipY2. Points holds
+    // pointCount x, y pairs, on pixel corners, so (0, 0) is the top left of the
+    // first pixel. A pixel is inside if its centre is, with the even-odd rule, so
+    // concave and self-intersecting polygons work, and polygons sharing an edge
+    // never both cover a pixel along it.
+    //
+    // Edges are sorted into an edge table by their first scanline, then moved into
+    // the active edge table as the scanlines reach them, so each scanline only
+    // looks at the edges that cross it.
+    template<typename SpanFunction> void fillPolygonSpans(const int* points, int pointCount,
+        int clipX, int clipY, int clipX2, int clipY2, SpanFunction span)
+    {
+        if(pointCount < 3)
+        {
+            return;
+        }
+
+        std::vector<PolygonEdge> edges;
+        edges.reserve(pointCount);
+        for(int i = 0; i < pointCount; i++)
+        {
+            int j = (i + 1) % pointCount;
+            int x = points[i * 2];
+            int y = points[i * 2 + 1];
+            int x2 = points[j * 2];
+            int y2 = points[j * 2 + 1];
+            if(y == y2)
+            {
+                continue;
+            }
+            if(y > y2)
+            {
+                std::swap(x, x2);
+                std::swap(y, y2);
+            }
+
+            // Scanlines whose centres fall in y..y2, skipping any above the clip.
+            PolygonEdge edge;
+            edge.y = std::max(y, clipY);
+            edge.y2 = std::min(y2, clipY2 + 1);
+            if(edge.y >= edge.y2)
+            {
+                continue;
+            }
+            // The crossing at scanline centre edge.y + 0.5 is run * k / (2 * height) along,
+            // split up so the product can't overflow.
+            long long height = (long long) y2 - y;
+            long long run = ((long long) x2 - x) * 65536;
+            long long k = 2 * ((long long) edge.y - y) + 1;
+            edge.fixedStep = run / height;
+            edge.fixedX = x * 65536LL + run / (2 * height) * k + run % (2 * height) * k / (2 * height);
+            edges.push_back(edge);
+        }
+        if(edges.empty())
+        {
+            return;
+        }
+        std::sort(edges.begin(), edges.end());
+
+        std::vector<PolygonEdge> active;
+        size_t next = 0;
+        int lastY = 0;
+        for(size_t i = 0; i < edges.size(); i++)
+        {
+            lastY = std::max(lastY, edges[i].y2);
+        }
+        for(int y = edges[0].y; y < lastY; y++)
+        {
+            // Drop edges that have ended, and pick up the ones starting here.
+            size_t kept = 0;
+            for(size_t i = 0; i < active.size(); i++)
+            {
+                if(active[i].y2 > y)
+                {
+                    active[kept++] = active[i];
+                }
+            }
+            active.resize(kept);
+            while(next < edges.size() && edges[next].y == y)
+            {
+                active.push_back(edges[next++]);
+            }
+
+            // Edges barely move between scanlines, so an insertion sort is nearly free.
+            for(size_t i = 1; i < active.size(); i++)
+            {
+                PolygonEdge edge = active[i];
+                size_t j = i;
+                while(j > 0 && active[j - 1].fixedX > edge.fixedX)
+                {
+                    active[j] = active[j - 1];
+                    j--;
+                }
+                active[j] = edge;
+            }
+
+            // Fill between pairs of crossings, taking the pixels whose centres are inside.
+            for(size_t i = 0; i + 1 < active.size(); i += 2)
+            {
+                long long x = std::max((active[i].fixedX + 32767) >> 16, (long long) clipX);
+                long long x2 = std::min(((active[i + 1].fixedX + 32767) >> 16) - 1, (long long) clipX2);
+                if(x <= x2)
+                {
+                    span(y, int(x), int(x2));
+                }
+            }
+
+            for(size_t i = 0; i < active.size(); i++)
+            {
+                active[i].fixedX += active[i].fixedStep;
+            }
+        }
+    }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,224 @@
+#ifndef VG_GRAPHICS_RLE_HPP
+#define VG_GRAPHICS_RLE_HPP
+
+#include <vector>
+#include <algorithm>
+#include "blend.hpp"
+#include "color.hpp"
+#include "image.hpp"
+#include "span.hpp"
+
+namespace vg
+{
+    // A sprite compiled from an Image, with each row split into runs of
+    // transparent, opaque and translucent pixels. Drawing skips transparent
+    // runs without touching them, and sends opaque runs straight to the copy
+    // path where the Blender allows it, so mostly empty sprites cost little.
+    //
+    // The pixels are kept alongside the runs, so Blenders that don't skip
+    // transparent pixels still get exactly the same result as Image::drawRegion.
+    // A RleImage is a snapshot: later changes to the source Image aren't seen.
+    class RleImage
+    {
+        private:
+            struct Run
+            {
+                AlphaClass alphaClass;
+                int x, x2;
+            };
+
+            int width, height;
+            ColorChannel opacity;
+            std::vector<Color> data;
+            std::vector<Run> runs;
+            // Index of the first run of each row, plus one past the last row.
+            std::vector<int> rowRuns;
+
+            static AlphaClass classifyPixel(Color color)
+            {
+                ColorChannel alpha = color[AlphaChannel];
+                return alpha == 0 ? AlphaTransparent : alpha == 255 ? AlphaOpaque : AlphaVariable;
+            }
+
+            template<OpacityClass Opacity, typename BlendFunction> void baseDrawRegion(int sourceX, int sourceY, int sourceX2, int sourceY2,
+                    int destX, int destY, Image* dest, BlendFunction f)
+            {
+                // Ensure that the source coordinates stay inside the image, which
+                // one made from an empty view has none of.
+                if(width == 0 || height == 0)
+                {
+                    return;
+                }
+                sourceX = std::min(std::max(0, sourceX), width - 1);
+                sourceY = std::min(std::max(0, sourceY), height - 1);
+                sourceX2 = std::min(std::max(0, sourceX2), width - 1);
+                sourceY2 = std::min(std::max(0, sourceY2), height - 1);
+
+                // Keep source rectangle coordinates in order.
+                if (sourceX > sourceX2)
+                {
+                    std::swap(sourceX, sourceX2);
+                }
+                if (sourceY > sourceY2)
+                {
+                    std::swap(sourceY, sourceY2);
+                }
+
+                int destX2 = destX + (sourceX2 - sourceX);
+                int destY2 = destY + (sourceY2 - sourceY);
+                int clipX, clipY, clipX2, clipY2;
+                dest->getClip(clipX, clipY, clipX2, clipY2);
+
+                // Don't draw if completely outside clipping regions.
+                if(destX > clipX2 || destX2 < clipX || destY > clipY2 || destY2 < clipY)
+                {
+                    return;
+                }
+
+                // Keep sample rectangle inside clipping regions.
+                if(destX < clipX)
+                {
+                    sourceX += clipX - destX;
+                    destX = clipX;
+                }
+                if(destX2 > clipX2)
+                {
+                    sourceX2 -= destX2 - clipX2;
+                }
+                if(destY < clipY)
+                {
+                    sourceY += clipY - destY;
+                    destY = clipY;
+                }
+                if(destY2 > clipY2)
+                {
+                    sourceY2 -= destY2 - clipY2;
+                }
+
+                // Walk the runs of each row, cut down to the sample rectangle.
+                Color* destData = dest->getRawData(destX, destY, destX + sourceX2 - sourceX, destY + sourceY2 - sourceY);
+                int destPitch = dest->getPitch();
+                for(int i = sourceY; i <= sourceY2; i++)
+                {
+                    const Color* sourceRow = &data[i * width];
+                    Color* destRow = destData + (destY + i - sourceY) * destPitch + destX - sourceX;
+                    // The runs are no help to Blenders that have to touch every pixel.
+                    if(!BlendTraits<BlendFunction>::SkipsTransparent)
+                    {
+                        blendSpan(sourceRow + sourceX, destRow + sourceX, sourceX2 - sourceX + 1, opacity, f);
+                        continue;
+                    }
+                    for(int r = rowRuns[i]; r < rowRuns[i + 1]; r++)
+                    {
+                        const Run& run = runs[r];
+                        if(run.x2 < sourceX)
+                        {
+                            continue;
+                        }
+                        if(run.x > sourceX2)
+                        {
+                            break;
+                        }
+
+                        int x = std::max(run.x, sourceX);
+                        int count = std::min(run.x2, sourceX2) - x + 1;
+                        switch(run.alphaClass)
+                        {
+                            case AlphaTransparent:
+                                ClassifiedSpan<Opacity, AlphaTransparent>::blend(sourceRow + x, destRow + x, count, opacity, f);
+                                break;
+                            case AlphaOpaque:
+                                ClassifiedSpan<Opacity, AlphaOpaque>::blend(sourceRow + x, destRow + x, count, opacity, f);
+                                break;
+                            default:
+                                ClassifiedSpan<Opacity, AlphaVariable>::blend(sourceRow + x, destRow + x, count, opacity, f);
+                                break;
+                        }
+                    }
+                }
+            }
+
+        public:
+            RleImage(const Image* source):
+                width(source->getWidth()), height(source->getHeight()),
+                opacity(source->getOpacity())
+            {
+                data.reserve(width * height);
+                for(int i = 0; i < height; i++)
+                {
+                    const Color* sourceRow = source->getRawData() + i * source->getPitch();
+                    data.insert(data.end(), sourceRow, sourceRow + width);
+                }
+
+                rowRuns.reserve(height + 1);
+                for(int i = 0; i < height; i++)
+                {
+                    rowRuns.push_back(int(runs.size()));
+
+                    const Color* row = &data[i * width];
+                    int j = 0;
+                    while(j < width)
+                    {
+                        Run run;
+                        run.alphaClass = classifyPixel(row[j]);
+                        run.x = j;
+                        while(j < width && classifyPixel(row[j]) == run.alphaClass)
+                        {
+                            j++;
+                        }
+                        run.x2 = j - 1;
+                        runs.push_back(run);
+                    }
+                }
+                rowRuns.push_back(int(runs.size()));
+            }
+
+            int getWidth() const
+            {
+                return width;
+            }
+
+            int getHeight() const
+            {
+                return height;
+            }
+
+            ColorChannel getOpacity() const
+            {
+                return opacity;
+            }
+
+            void setOpacity(ColorChannel opacity)
+            {
+                this->opacity = opacity;
+            }
+
+            template<typename BlendFunction> void draw(int x, int y, Image* dest, BlendFunction f)
+            {
+                drawRegion(0, 0, width - 1, height - 1, x, y, dest, f);
+            }
+
+            // Draws with the same clipping rules and results as Image::drawRegion.
+            template<typename BlendFunction> void drawRegion(int sourceX, int sourceY, int sourceX2, int sourceY2,
+                    int destX, int destY, Image* dest, BlendFunction f)
+            {
+                switch(classifyOpacity(opacity))
+                {
+                    case OpacityZero:
+                        if(!BlendTraits<BlendFunction>::SkipsTransparent)
+                        {
+                            baseDrawRegion<OpacityZero>(sourceX, sourceY, sourceX2, sourceY2, destX, destY, dest, f);
+                        }
+                        break;
+                    case OpacityFull:
+                        baseDrawRegion<OpacityFull>(sourceX, sourceY, sourceX2, sourceY2, destX, destY, dest, f);
+                        break;
+                    default:
+                        baseDrawRegion<OpacityPartial>(sourceX, sourceY, sourceX2, sourceY2, destX, destY, dest, f);
+                        break;
+                }
+            }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,353 @@
+#ifndef VG_GRAPHICS_SIMD_HPP
+#define VG_GRAPHICS_SIMD_HPP
+
+// Vector instruction sets are picked at compile time. Define VG_NO_SIMD to
+// force the plain scalar code paths everywhere.
+#ifndef VG_NO_SIMD
+    #if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define VG_SSE2
+    #endif
+    #if defined(VG_SSE2) && defined(__AVX2__)
+        #define VG_AVX2
+    #endif
+#endif
+
+#ifdef VG_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef VG_AVX2
+#include <immintrin.h>
+#endif
+
+#include "color.hpp"
+
+namespace vg
+{
+    namespace simd
+    {
+        // Each instruction set is wrapped in a struct of static functions with
+        // identical names, so kernels can be written once as templates over it.
+        //
+        // Pixels are loaded as packed 32-bit BGRA, then widened to 16-bit lanes
+        // (unpackLow/unpackHigh) for arithmetic, so every intermediate product
+        // of two channels fits in an unsigned 16-bit lane.
+        // Functions suffixed with 32 treat the vector as one 32-bit lane per pixel.
+#ifdef VG_SSE2
+        struct Sse2
+        {
+            typedef __m128i Vector;
+            enum { Width = 4 };
+
+            static Vector load(const Color* p)
+            {
+                return _mm_loadu_si128((const __m128i*) p);
+            }
+
+            static void store(Color* p, Vector v)
+            {
+                _mm_storeu_si128((__m128i*) p, v);
+            }
+
+            // Loads 16-bit lanes that are already widened, two channels' worth per pixel.
+            static Vector load(const unsigned short* p)
+            {
+                return _mm_loadu_si128((const __m128i*) p);
+            }
+
+            static Vector zero()
+            {
+                return _mm_setzero_si128();
+            }
+
+            static Vector splat16(int value)
+            {
+                return _mm_set1_epi16(short(value));
+            }
+
+            static Vector splat32(unsigned int value)
+            {
+                return _mm_set1_epi32(int(value));
+            }
+
+            static Vector unpackLow(Vector v)
+            {
+                return _mm_unpacklo_epi8(v, _mm_setzero_si128());
+            }
+
+            static Vector unpackHigh(Vector v)
+            {
+                return _mm_unpackhi_epi8(v, _mm_setzero_si128());
+            }
+
+            // Packs 16-bit lanes back to bytes, saturating to 0..255.
+            static Vector pack(Vector low, Vector high)
+            {
+                return _mm_packus_epi16(low, high);
+            }
+
+            // Packs 16-bit lanes loaded straight from memory, rather than made by
+            // unpackLow/unpackHigh, keeping the pixels in memory order.
+            static Vector packInOrder(Vector low, Vector high)
+            {
+                return _mm_packus_epi16(low, high);
+            }
+
+            static Vector add(Vector a, Vector b)
+            {
+                return _mm_add_epi16(a, b);
+            }
+
+            static Vector subtract(Vector a, Vector b)
+            {
+                return _mm_sub_epi16(a, b);
+            }
+
+            static Vector multiply(Vector a, Vector b)
+            {
+                return _mm_mullo_epi16(a, b);
+            }
+
+            // (a * b) >> 16 for unsigned 16-bit lanes.
+            static Vector multiplyHigh(Vector a, Vector b)
+            {
+                return _mm_mulhi_epu16(a, b);
+            }
+
+            static Vector minimum(Vector a, Vector b)
+            {
+                return _mm_min_epi16(a, b);
+            }
+
+            static Vector maximum(Vector a, Vector b)
+            {
+                return _mm_max_epi16(a, b);
+            }
+
+            static Vector greater(Vector a, Vector b)
+            {
+                return _mm_cmpgt_epi16(a, b);
+            }
+
+            static Vector bitAnd(Vector a, Vector b)
+            {
+                return _mm_and_si128(a, b);
+            }
+
+            // Returns ~mask & v.
+            static Vector bitAndNot(Vector mask, Vector v)
+            {
+                return _mm_andnot_si128(mask, v);
+            }
+
+            static Vector bitOr(Vector a, Vector b)
+            {
+                return _mm_or_si128(a, b);
+            }
+
+            static Vector bitXor(Vector a, Vector b)
+            {
+                return _mm_xor_si128(a, b);
+            }
+
+            // Exact v / 256 for unsigned 16-bit lanes.
+            static Vector divide256(Vector v)
+            {
+                return _mm_srli_epi16(v, 8);
+            }
+
+            // Exact v / 255 for unsigned 16-bit lanes: (v * 0x8081) >> 23.
+            static Vector divide255(Vector v)
+            {
+                return _mm_srli_epi16(_mm_mulhi_epu16(v, _mm_set1_epi16(short(0x8081))), 7);
+            }
+
+            static Vector alpha32(Vector v)
+            {
+                return _mm_srli_epi32(v, 24);
+            }
+
+            static Vector shiftAlpha32(Vector v)
+            {
+                return _mm_slli_epi32(v, 24);
+            }
+
+            // Spreads a per-pixel value (low 16 bits of each 32-bit lane)
+            // across the four 16-bit channel lanes of that pixel, matching
+            // the pixel order of unpackLow/unpackHigh.
+            static Vector spreadLow32(Vector v)
+            {
+                v = _mm_or_si128(v, _mm_slli_epi32(v, 16));
+                return _mm_unpacklo_epi32(v, v);
+            }
+
+            static Vector spreadHigh32(Vector v)
+            {
+                v = _mm_or_si128(v, _mm_slli_epi32(v, 16));
+                return _mm_unpackhi_epi32(v, v);
+            }
+
+            // Truncating numerator / denominator on 32-bit lanes. Exact for
+            // operands below 2^16, which is all the blenders ever need.
+            static Vector divide32(Vector numerator, Vector denominator)
+            {
+                return _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(numerator), _mm_cvtepi32_ps(denominator)));
+            }
+        };
+#endif
+
+#ifdef VG_AVX2
+        struct Avx2
+        {
+            typedef __m256i Vector;
+            enum { Width = 8 };
+
+            static Vector load(const Color* p)
+            {
+                return _mm256_loadu_si256((const __m256i*) p);
+            }
+
+            static void store(Color* p, Vector v)
+            {
+                _mm256_storeu_si256((__m256i*) p, v);
+            }
+
+            static Vector load(const unsigned short* p)
+            {
+                return _mm256_loadu_si256((const __m256i*) p);
+            }
+
+            static Vector zero()
+            {
+                return _mm256_setzero_si256();
+            }
+
+            static Vector splat16(int value)
+            {
+                return _mm256_set1_epi16(short(value));
+            }
+
+            static Vector splat32(unsigned int value)
+            {
+                return _mm256_set1_epi32(int(value));
+            }
+
+            static Vector unpackLow(Vector v)
+            {
+                return _mm256_unpacklo_epi8(v, _mm256_setzero_si256());
+            }
+
+            static Vector unpackHigh(Vector v)
+            {
+                return _mm256_unpackhi_epi8(v, _mm256_setzero_si256());
+            }
+
+            static Vector pack(Vector low, Vector high)
+            {
+                return _mm256_packus_epi16(low, high);
+            }
+
+            // The pack works within each 128-bit half, so put the halves back in order.
+            static Vector packInOrder(Vector low, Vector high)
+            {
+                return _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+            }
+
+            static Vector add(Vector a, Vector b)
+            {
+                return _mm256_add_epi16(a, b);
+            }
+
+            static Vector subtract(Vector a, Vector b)
+            {
+                return _mm256_sub_epi16(a, b);
+            }
+
+            static Vector multiply(Vector a, Vector b)
+            {
+                return _mm256_mullo_epi16(a, b);
+            }
+
+            static Vector multiplyHigh(Vector a, Vector b)
+            {
+                return _mm256_mulhi_epu16(a, b);
+            }
+
+            static Vector minimum(Vector a, Vector b)
+            {
+                return _mm256_min_epi16(a, b);
+            }
+
+            static Vector maximum(Vector a, Vector b)
+            {
+                return _mm256_max_epi16(a, b);
+            }
+
+            static Vector greater(Vector a, Vector b)
+            {
+                return _mm256_cmpgt_epi16(a, b);
+            }
+
+            static Vector bitAnd(Vector a, Vector b)
+            {
+                return _mm256_and_si256(a, b);
+            }
+
+            static Vector bitAndNot(Vector mask, Vector v)
+            {
+                return _mm256_andnot_si256(mask, v);
+            }
+
+            static Vector bitOr(Vector a, Vector b)
+            {
+                return _mm256_or_si256(a, b);
+            }
+
+            static Vector bitXor(Vector a, Vector b)
+            {
+                return _mm256_xor_si256(a, b);
+            }
+
+            static Vector divide256(Vector v)
+            {
+                return _mm256_srli_epi16(v, 8);
+            }
+
+            static Vector divide255(Vector v)
+            {
+                return _mm256_srli_epi16(_mm256_mulhi_epu16(v, _mm256_set1_epi16(short(0x8081))), 7);
+            }
+
+            static Vector alpha32(Vector v)
+            {
+                return _mm256_srli_epi32(v, 24);
+            }
+
+            static Vector shiftAlpha32(Vector v)
+            {
+                return _mm256_slli_epi32(v, 24);
+            }
+
+            // The AVX2 unpack instructions work within each 128-bit half,
+            // and so do these, so pixel order still lines up.
+            static Vector spreadLow32(Vector v)
+            {
+                v = _mm256_or_si256(v, _mm256_slli_epi32(v, 16));
+                return _mm256_unpacklo_epi32(v, v);
+            }
+
+            static Vector spreadHigh32(Vector v)
+            {
+                v = _mm256_or_si256(v, _mm256_slli_epi32(v, 16));
+                return _mm256_unpackhi_epi32(v, v);
+            }
+
+            static Vector divide32(Vector numerator, Vector denominator)
+            {
+                return _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(numerator), _mm256_cvtepi32_ps(denominator)));
+            }
+        };
+#endif
+    }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,770 @@
+#ifndef VG_GRAPHICS_SPAN_HPP
+#define VG_GRAPHICS_SPAN_HPP
+
+#include <cstring>
+#include <algorithm>
+#include "blend.hpp"
+#include "color.hpp"
+#include "simd.hpp"
+
+namespace vg
+{
+    namespace simd
+    {
+        // Channel mixes for the vectorized span kernels. Each one takes the
+        // source, dest and effective source alpha as 16-bit lanes, and must
+        // produce exactly what the matching scalar Blender in blend.hpp does,
+        // including C's truncation toward zero on negative quotients.
+
+        // dest + (alpha * (target - dest)) / 255, truncated toward zero.
+        template<typename Isa> typename Isa::Vector approach(typename Isa::Vector target,
+            typename Isa::Vector dest, typename Isa::Vector alpha)
+        {
+            typedef typename Isa::Vector Vector;
+            Vector magnitude = Isa::divide255(Isa::multiply(alpha,
+                Isa::subtract(Isa::maximum(target, dest), Isa::minimum(target, dest))));
+            Vector negative = Isa::greater(dest, target);
+            return Isa::add(dest, Isa::subtract(Isa::bitXor(magnitude, negative), negative));
+        }
+
+        struct PreserveMix
+        {
+            template<typename Isa> static typename Isa::Vector mix(typename Isa::Vector source,
+                typename Isa::Vector dest, typename Isa::Vector alpha)
+            {
+                return approach<Isa>(source, dest, alpha);
+            }
+        };
+
+        struct AddMix
+        {
+            // Overflow past 255 is clamped by the saturating pack.
+            template<typename Isa> static typename Isa::Vector mix(typename Isa::Vector source,
+                typename Isa::Vector dest, typename Isa::Vector alpha)
+            {
+                return Isa::add(dest, Isa::divide255(Isa::multiply(alpha, source)));
+            }
+        };
+
+        struct SubtractMix
+        {
+            // Underflow past 0 is clamped by the saturating pack.
+            template<typename Isa> static typename Isa::Vector mix(typename Isa::Vector source,
+                typename Isa::Vector dest, typename Isa::Vector alpha)
+            {
+                return Isa::subtract(dest, Isa::divide255(Isa::multiply(alpha, source)));
+            }
+        };
+
+        struct ScreenMix
+        {
+            template<typename Isa> static typename Isa::Vector mix(typename Isa::Vector source,
+                typename Isa::Vector dest, typename Isa::Vector alpha)
+            {
+                typename Isa::Vector full = Isa::splat16(255);
+                typename Isa::Vector target = Isa::subtract(full, Isa::divide255(
+                    Isa::multiply(Isa::subtract(full, source), Isa::subtract(full, dest))));
+                return approach<Isa>(target, dest, alpha);
+            }
+        };
+
+        struct MultiplyMix
+        {
+            template<typename Isa> static typename Isa::Vector mix(typename Isa::Vector source,
+                typename Isa::Vector dest, typename Isa::Vector alpha)
+            {
+                return approach<Isa>(Isa::divide256(Isa::multiply(source, dest)), dest, alpha);
+            }
+        };
+
+        struct LightenMix
+        {
+            template<typename Isa> static typename Isa::Vector mix(typename Isa::Vector source,
+                typename Isa::Vector dest, typename Isa::Vector alpha)
+            {
+                return approach<Isa>(Isa::maximum(source, dest), dest, alpha);
+            }
+        };
+
+        struct DarkenMix
+        {
+            template<typename Isa> static typename Isa::Vector mix(typename Isa::Vector source,
+                typename Isa::Vector dest, typename Isa::Vector alpha)
+            {
+                return approach<Isa>(Isa::minimum(source, dest), dest, alpha);
+            }
+        };
+
+        struct DifferenceMix
+        {
+            template<typename Isa> static typename Isa::Vector mix(typename Isa::Vector source,
+                typename Isa::Vector dest, typename Isa::Vector alpha)
+            {
+                return approach<Isa>(Isa::subtract(Isa::maximum(source, dest), Isa::minimum(source, dest)), dest, alpha);
+            }
+        };
+
+        // How a kernel gets the effective alpha of each source pixel, which the
+        // scalar Blenders always compute as source alpha * opacity / 255.
+        // Each takes the source pixels and the opacity splatted to 32-bit lanes.
+        struct ScaledAlpha
+        {
+            template<typename Isa> static typename Isa::Vector get(typename Isa::Vector source, typename Isa::Vector opacity)
+            {
+                return Isa::divide255(Isa::multiply(Isa::alpha32(source), opacity));
+            }
+        };
+
+        // Full opacity: the effective alpha is just the source alpha.
+        struct SourceAlpha
+        {
+            template<typename Isa> static typename Isa::Vector get(typename Isa::Vector source, typename Isa::Vector)
+            {
+                return Isa::alpha32(source);
+            }
+        };
+
+        // Opaque source: the effective alpha is just the opacity.
+        struct ConstantAlpha
+        {
+            template<typename Isa> static typename Isa::Vector get(typename Isa::Vector, typename Isa::Vector opacity)
+            {
+                return opacity;
+            }
+        };
+
+        // Blends as many whole vectors as fit in count, for the blenders that
+        // leave the dest alpha untouched. Returns the number of pixels done.
+        template<typename Isa, typename Mix, typename Alpha> int blendVectors(const Color* source, Color* dest, int count, ColorChannel opacity)
+        {
+            typedef typename Isa::Vector Vector;
+            const Vector alphaMask = Isa::splat32(0xFF000000);
+            const Vector opacityScale = Isa::splat32(opacity);
+
+            int i = 0;
+            for(; i + Isa::Width <= count; i += Isa::Width)
+            {
+                Vector s = Isa::load(source + i);
+                Vector d = Isa::load(dest + i);
+                Vector alpha = Alpha::template get<Isa>(s, opacityScale);
+
+                Vector low = Mix::template mix<Isa>(Isa::unpackLow(s), Isa::unpackLow(d), Isa::spreadLow32(alpha));
+                Vector high = Mix::template mix<Isa>(Isa::unpackHigh(s), Isa::unpackHigh(d), Isa::spreadHigh32(alpha));
+                Vector result = Isa::pack(low, high);
+
+                Isa::store(dest + i, Isa::bitOr(Isa::bitAndNot(alphaMask, result), Isa::bitAnd(alphaMask, d)));
+            }
+            return i;
+        }
+
+        // Merge needs a per-pixel division to turn the source alpha into a
+        // weight against the combined alpha. It's done in single precision,
+        // which is exact for every quotient a pair of 8-bit alphas can make.
+        template<typename Isa, typename Alpha> int mergeVectors(const Color* source, Color* dest, int count, ColorChannel opacity)
+        {
+            typedef typename Isa::Vector Vector;
+            const Vector alphaMask = Isa::splat32(0xFF000000);
+            const Vector opacityScale = Isa::splat32(opacity);
+            const Vector full = Isa::splat32(255);
+            const Vector one = Isa::splat32(1);
+
+            int i = 0;
+            for(; i + Isa::Width <= count; i += Isa::Width)
+            {
+                Vector s = Isa::load(source + i);
+                Vector d = Isa::load(dest + i);
+                Vector sourceAlpha = Alpha::template get<Isa>(s, opacityScale);
+                Vector finalAlpha = Isa::add(sourceAlpha, Isa::divide255(Isa::multiply(Isa::subtract(full, sourceAlpha), Isa::alpha32(d))));
+                Vector weight = Isa::divide32(Isa::multiply(sourceAlpha, full), Isa::maximum(finalAlpha, one));
+
+                Vector lowWeight = Isa::spreadLow32(weight);
+                Vector highWeight = Isa::spreadHigh32(weight);
+                Vector fullChannel = Isa::splat16(255);
+                Vector low = Isa::divide255(Isa::add(
+                    Isa::multiply(Isa::unpackLow(s), lowWeight),
+                    Isa::multiply(Isa::unpackLow(d), Isa::subtract(fullChannel, lowWeight))));
+                Vector high = Isa::divide255(Isa::add(
+                    Isa::multiply(Isa::unpackHigh(s), highWeight),
+                    Isa::multiply(Isa::unpackHigh(d), Isa::subtract(fullChannel, highWeight))));
+                Vector result = Isa::pack(low, high);
+
+                Isa::store(dest + i, Isa::bitOr(Isa::bitAndNot(alphaMask, result), Isa::shiftAlpha32(finalAlpha)));
+            }
+            return i;
+        }
+
+        // Channel mixes for the premultiplied Blenders. These work on all four
+        // channels, with the source already scaled by the opacity.
+        struct PremultipliedMergeMix
+        {
+            template<typename Isa> static typename Isa::Vector mix(typename Isa::Vector source,
+                typename Isa::Vector dest, typename Isa::Vector alpha)
+            {
+                return Isa::add(source, Isa::divide255(Isa::multiply(dest, Isa::subtract(Isa::splat16(255), alpha))));
+            }
+        };
+
+        struct PremultipliedAddMix
+        {
+            template<typename Isa> static typename Isa::Vector mix(typename Isa::Vector source,
+                typename Isa::Vector dest, typename Isa::Vector alpha)
+            {
+                return Isa::add(source, dest);
+            }
+        };
+
+        struct PremultipliedScreenMix
+        {
+            template<typename Isa> static typename Isa::Vector mix(typename Isa::Vector source,
+                typename Isa::Vector dest, typename Isa::Vector alpha)
+            {
+                return Isa::subtract(Isa::add(source, dest), Isa::divide255(Isa::multiply(source, dest)));
+            }
+        };
+
+        // Blends as many whole vectors as fit in count, for the premultiplied
+        // blenders. Returns the number of pixels done.
+        template<typename Isa, typename Mix, typename Alpha> int premultipliedVectors(const Color* source, Color* dest, int count, ColorChannel opacity)
+        {
+            typedef typename Isa::Vector Vector;
+            const Vector opacityScale = Isa::splat32(opacity);
+            const Vector channelScale = Isa::splat16(opacity);
+            const bool scaled = opacity != 255;
+
+            int i = 0;
+            for(; i + Isa::Width <= count; i += Isa::Width)
+            {
+                Vector s = Isa::load(source + i);
+                Vector d = Isa::load(dest + i);
+                Vector alpha = Alpha::template get<Isa>(s, opacityScale);
+
+                Vector lowSource = Isa::unpackLow(s);
+                Vector highSource = Isa::unpackHigh(s);
+                if(scaled)
+                {
+                    lowSource = Isa::divide255(Isa::multiply(lowSource, channelScale));
+                    highSource = Isa::divide255(Isa::multiply(highSource, channelScale));
+                }
+
+                Vector low = Mix::template mix<Isa>(lowSource, Isa::unpackLow(d), Isa::spreadLow32(alpha));
+                Vector high = Mix::template mix<Isa>(highSource, Isa::unpackHigh(d), Isa::spreadHigh32(alpha));
+                Isa::store(dest + i, Isa::pack(low, high));
+            }
+            return i;
+        }
+
+        // Maps a Blender onto its vector kernel. Blenders without one
+        // report zero pixels done, and fall through to the scalar loop.
+        template<typename BlendFunction> struct Kernel
+        {
+            template<typename Isa, typename Alpha> static int run(const Color*, Color*, int, ColorChannel)
+            {
+                return 0;
+            }
+        };
+
+        template<typename Mix> struct MixKernel
+        {
+            template<typename Isa, typename Alpha> static int run(const Color* source, Color* dest, int count, ColorChannel opacity)
+            {
+                return blendVectors<Isa, Mix, Alpha>(source, dest, count, opacity);
+            }
+        };
+
+        template<> struct Kernel<PreserveBlender> : public MixKernel<PreserveMix> {};
+        template<> struct Kernel<AddBlender> : public MixKernel<AddMix> {};
+        template<> struct Kernel<SubtractBlender> : public MixKernel<SubtractMix> {};
+        template<> struct Kernel<ScreenBlender> : public MixKernel<ScreenMix> {};
+        template<> struct Kernel<MultiplyBlender> : public MixKernel<MultiplyMix> {};
+        template<> struct Kernel<LightenBlender> : public MixKernel<LightenMix> {};
+        template<> struct Kernel<DarkenBlender> : public MixKernel<DarkenMix> {};
+        template<> struct Kernel<DifferenceBlender> : public MixKernel<DifferenceMix> {};
+
+        template<> struct Kernel<MergeBlender>
+        {
+            template<typename Isa, typename Alpha> static int run(const Color* source, Color* dest, int count, ColorChannel opacity)
+            {
+                return mergeVectors<Isa, Alpha>(source, dest, count, opacity);
+            }
+        };
+
+        template<typename Mix> struct PremultipliedKernel
+        {
+            template<typename Isa, typename Alpha> static int run(const Color* source, Color* dest, int count, ColorChannel opacity)
+            {
+                return premultipliedVectors<Isa, Mix, Alpha>(source, dest, count, opacity);
+            }
+        };
+
+        template<> struct Kernel<PremultipliedMergeBlender> : public PremultipliedKernel<PremultipliedMergeMix> {};
+        template<> struct Kernel<PremultipliedAddBlender> : public PremultipliedKernel<PremultipliedAddMix> {};
+        template<> struct Kernel<PremultipliedScreenBlender> : public PremultipliedKernel<PremultipliedScreenMix> {};
+
+        // Runs the widest available kernel, then narrower ones on what's left.
+        // Returns the number of pixels done; the rest are left to the scalar Blender.
+        template<typename BlendFunction, typename Alpha> int runWidest(const Color* source, Color* dest, int count, ColorChannel opacity)
+        {
+            int done = 0;
+#ifdef VG_AVX2
+            done += Kernel<BlendFunction>::template run<Avx2, Alpha>(source + done, dest + done, count - done, opacity);
+#endif
+#ifdef VG_SSE2
+            done += Kernel<BlendFunction>::template run<Sse2, Alpha>(source + done, dest + done, count - done, opacity);
+#endif
+            return done;
+        }
+
+        // Constant-source kernels, for blending one colour over a span. The source
+        // pixels and their effective alpha are the same everywhere, so they're
+        // worked out once, and each vector only has to load, mix and store the dest.
+
+        // Stores color over as many whole vectors as fit in count. Returns the number of pixels done.
+        template<typename Isa> int fillVectors(Color color, Color* dest, int count)
+        {
+            typedef typename Isa::Vector Vector;
+            const Vector fill = Isa::splat32(color);
+
+            int i = 0;
+            for(; i + Isa::Width <= count; i += Isa::Width)
+            {
+                Isa::store(dest + i, fill);
+            }
+            return i;
+        }
+
+        // The colour's effective alpha, as the scalar Blenders work it out.
+        inline int getColorAlpha(Color color, ColorChannel opacity)
+        {
+            return color[AlphaChannel] * opacity / 255;
+        }
+
+        template<typename Isa, typename Mix> int blendColorVectors(Color color, Color* dest, int count, ColorChannel opacity)
+        {
+            typedef typename Isa::Vector Vector;
+            const Vector alphaMask = Isa::splat32(0xFF000000);
+            // Every pixel is the same, so the low and high halves unpack alike.
+            const Vector source = Isa::unpackLow(Isa::splat32(color));
+            const Vector alpha = Isa::splat16(getColorAlpha(color, opacity));
+
+            int i = 0;
+            for(; i + Isa::Width <= count; i += Isa::Width)
+            {
+                Vector d = Isa::load(dest + i);
+                Vector low = Mix::template mix<Isa>(source, Isa::unpackLow(d), alpha);
+                Vector high = Mix::template mix<Isa>(source, Isa::unpackHigh(d), alpha);
+                Vector result = Isa::pack(low, high);
+
+                Isa::store(dest + i, Isa::bitOr(Isa::bitAndNot(alphaMask, result), Isa::bitAnd(alphaMask, d)));
+            }
+            return i;
+        }
+
+        // Merge still depends on each dest alpha, but only through the combined
+        // alpha; the source side of it is hoisted.
+        template<typename Isa> int mergeColorVectors(Color color, Color* dest, int count, ColorChannel opacity)
+        {
+            typedef typename Isa::Vector Vector;
+            const Vector alphaMask = Isa::splat32(0xFF000000);
+            const Vector full = Isa::splat32(255);
+            const Vector one = Isa::splat32(1);
+            const Vector fullChannel = Isa::splat16(255);
+            const Vector source = Isa::unpackLow(Isa::splat32(color));
+            const Vector sourceAlpha = Isa::splat32(getColorAlpha(color, opacity));
+            const Vector remainingAlpha = Isa::subtract(full, sourceAlpha);
+            const Vector weightNumerator = Isa::multiply(sourceAlpha, full);
+
+            int i = 0;
+            for(; i + Isa::Width <= count; i += Isa::Width)
+            {
+                Vector d = Isa::load(dest + i);
+                Vector finalAlpha = Isa::add(sourceAlpha, Isa::divide255(Isa::multiply(remainingAlpha, Isa::alpha32(d))));
+                Vector weight = Isa::divide32(weightNumerator, Isa::maximum(finalAlpha, one));
+
+                Vector lowWeight = Isa::spreadLow32(weight);
+                Vector highWeight = Isa::spreadHigh32(weight);
+                Vector low = Isa::divide255(Isa::add(
+                    Isa::multiply(source, lowWeight),
+                    Isa::multiply(Isa::unpackLow(d), Isa::subtract(fullChannel, lowWeight))));
+                Vector high = Isa::divide255(Isa::add(
+                    Isa::multiply(source, highWeight),
+                    Isa::multiply(Isa::unpackHigh(d), Isa::subtract(fullChannel, highWeight))));
+                Vector result = Isa::pack(low, high);
+
+                Isa::store(dest + i, Isa::bitOr(Isa::bitAndNot(alphaMask, result), Isa::shiftAlpha32(finalAlpha)));
+            }
+            return i;
+        }
+
+        template<typename Isa, typename Mix> int premultipliedColorVectors(Color color, Color* dest, int count, ColorChannel opacity)
+        {
+            typedef typename Isa::Vector Vector;
+            Vector source = Isa::unpackLow(Isa::splat32(color));
+            if(opacity != 255)
+            {
+                source = Isa::divide255(Isa::multiply(source, Isa::splat16(opacity)));
+            }
+            const Vector alpha = Isa::splat16(getColorAlpha(color, opacity));
+
+            int i = 0;
+            for(; i + Isa::Width <= count; i += Isa::Width)
+            {
+                Vector d = Isa::load(dest + i);
+                Vector low = Mix::template mix<Isa>(source, Isa::unpackLow(d), alpha);
+                Vector high = Mix::template mix<Isa>(source, Isa::unpackHigh(d), alpha);
+                Isa::store(dest + i, Isa::pack(low, high));
+            }
+            return i;
+        }
+
+        // Maps a Blender onto its constant-source kernel, like Kernel does for spans.
+        template<typename BlendFunction> struct ColorKernel
+        {
+            template<typename Isa> static int run(Color color, Color* dest, int count, ColorChannel opacity)
+            {
+                return 0;
+            }
+        };
+
+        template<typename Mix> struct MixColorKernel
+        {
+            template<typename Isa> static int run(Color color, Color* dest, int count, ColorChannel opacity)
+            {
+                return blendColorVectors<Isa, Mix>(color, dest, count, opacity);
+            }
+        };
+
+        template<> struct ColorKernel<PreserveBlender> : public MixColorKernel<PreserveMix> {};
+        template<> struct ColorKernel<AddBlender> : public MixColorKernel<AddMix> {};
+        template<> struct ColorKernel<SubtractBlender> : public MixColorKernel<SubtractMix> {};
+        template<> struct ColorKernel<ScreenBlender> : public MixColorKernel<ScreenMix> {};
+        template<> struct ColorKernel<MultiplyBlender> : public MixColorKernel<MultiplyMix> {};
+        template<> struct ColorKernel<LightenBlender> : public MixColorKernel<LightenMix> {};
+        template<> struct ColorKernel<DarkenBlender> : public MixColorKernel<DarkenMix> {};
+        template<> struct ColorKernel<DifferenceBlender> : public MixColorKernel<DifferenceMix> {};
+
+        template<> struct ColorKernel<MergeBlender>
+        {
+            template<typename Isa> static int run(Color color, Color* dest, int count, ColorChannel opacity)
+            {
+                return mergeColorVectors<Isa>(color, dest, count, opacity);
+            }
+        };
+
+        template<typename Mix> struct PremultipliedColorKernel
+        {
+            template<typename Isa> static int run(Color color, Color* dest, int count, ColorChannel opacity)
+            {
+                // Alpha 0 alone doesn't make a premultiplied colour a no-op, as it can still
+                // add light, but a colour that scales to zero in every channel leaves the dest as it is.
+                if(color[RedChannel] * opacity < 255 && color[GreenChannel] * opacity < 255
+                    && color[BlueChannel] * opacity < 255 && color[AlphaChannel] * opacity < 255)
+                {
+                    return count;
+                }
+                return premultipliedColorVectors<Isa, Mix>(color, dest, count, opacity);
+            }
+        };
+
+        template<> struct ColorKernel<PremultipliedMergeBlender> : public PremultipliedColorKernel<PremultipliedMergeMix> {};
+        template<> struct ColorKernel<PremultipliedAddBlender> : public PremultipliedColorKernel<PremultipliedAddMix> {};
+        template<> struct ColorKernel<PremultipliedScreenBlender> : public PremultipliedColorKernel<PremultipliedScreenMix> {};
+
+        template<typename BlendFunction> int runWidestColor(Color color, Color* dest, int count, ColorChannel opacity)
+        {
+            int done = 0;
+#ifdef VG_AVX2
+            done += ColorKernel<BlendFunction>::template run<Avx2>(color, dest + done, count - done, opacity);
+#endif
+#ifdef VG_SSE2
+            done += ColorKernel<BlendFunction>::template run<Sse2>(color, dest + done, count - done, opacity);
+#endif
+            return done;
+        }
+
+        inline int fillWidest(Color color, Color* dest, int count)
+        {
+            int done = 0;
+#ifdef VG_AVX2
+            done += fillVectors<Avx2>(color, dest + done, count - done);
+#endif
+#ifdef VG_SSE2
+            done += fillVectors<Sse2>(color, dest + done, count - done);
+#endif
+            return done;
+        }
+    }
+
+    // Blends a span, getting each pixel's effective alpha as the Alpha policy says.
+    // Policies other than simd::ScaledAlpha are only valid when the caller knows
+    // they give the same alpha; see ClassifiedSpan.
+    template<typename Alpha, typename BlendFunction> void blendSpanAs(const Color* source, Color* dest, int count, ColorChannel opacity, BlendFunction f)
+    {
+        int i = simd::runWidest<BlendFunction, Alpha>(source, dest, count, opacity);
+        for(; i < count; i++)
+        {
+            dest[i] = f(source[i], dest[i], opacity);
+        }
+    }
+
+    // Span blending is the row-level counterpart to the per-pixel Blender functors:
+    // blendSpan(source, dest, count, opacity, f) blends count contiguous pixels
+    // from a source row onto a dest row, as if f were called on each pair.
+    // Image draws everything through it, a whole clipped scanline per call.
+    //
+    // The built-in Blenders run vector kernels, bit-for-bit identical to the
+    // scalar result, and anything else calls the BlendFunction once per pixel.
+    // A custom Blender can provide its own row version by overloading blendSpan
+    // in its namespace.
+    template<typename BlendFunction> void blendSpan(const Color* source, Color* dest, int count, ColorChannel opacity, BlendFunction f)
+    {
+        blendSpanAs<simd::ScaledAlpha>(source, dest, count, opacity, f);
+    }
+
+    inline void blendSpan(const Color* source, Color* dest, int count, ColorChannel, CopyBlender)
+    {
+        std::memmove(dest, source, count * sizeof(*dest));
+    }
+
+    // Works out the AlphaClass of a row of pixels.
+    inline AlphaClass classifyAlpha(const Color* source, int count)
+    {
+        bool opaque = false;
+        bool transparent = false;
+        for(int i = 0; i < count; i++)
+        {
+            ColorChannel alpha = source[i][AlphaChannel];
+            if(alpha == 255)
+            {
+                opaque = true;
+            }
+            else if(alpha == 0)
+            {
+                transparent = true;
+            }
+            else
+            {
+                return AlphaVariable;
+            }
+        }
+        return opaque ? (transparent ? AlphaBinary : AlphaOpaque) : AlphaTransparent;
+    }
+
+    // A summary of the alpha channel in one row of pixels.
+    struct AlphaRowInfo
+    {
+        AlphaClass alphaClass;
+        // First and last pixels that aren't fully transparent. left > right if there are none.
+        int left, right;
+        // The longest run of fully opaque pixels. opaqueLeft > opaqueRight if there are none.
+        int opaqueLeft, opaqueRight;
+    };
+
+    inline AlphaRowInfo summarizeAlpha(const Color* source, int count)
+    {
+        AlphaRowInfo info;
+        info.left = count;
+        info.right = -1;
+        info.opaqueLeft = 0;
+        info.opaqueRight = -1;
+
+        bool opaque = false;
+        bool transparent = false;
+        bool variable = false;
+        int runStart = -1;
+        for(int i = 0; i < count; i++)
+        {
+            ColorChannel alpha = source[i][AlphaChannel];
+            if(alpha != 0)
+            {
+                info.left = std::min(info.left, i);
+                info.right = i;
+            }
+            if(alpha == 255)
+            {
+                opaque = true;
+                if(runStart < 0)
+                {
+                    runStart = i;
+                }
+                if(i - runStart > info.opaqueRight - info.opaqueLeft)
+                {
+                    info.opaqueLeft = runStart;
+                    info.opaqueRight = i;
+                }
+            }
+            else
+            {
+                runStart = -1;
+                if(alpha == 0)
+                {
+                    transparent = true;
+                }
+                else
+                {
+                    variable = true;
+                }
+            }
+        }
+        info.alphaClass = variable ? AlphaVariable : opaque ? (transparent ? AlphaBinary : AlphaOpaque) : AlphaTransparent;
+        return info;
+    }
+
+    // Span blending specialized on what's known ahead of time about the opacity and
+    // the source alpha, which lets whole spans be skipped, copied, or blended without
+    // scaling every alpha by the opacity. Only for Blenders with BlendTraits.
+    template<OpacityClass Opacity, AlphaClass Alpha> struct ClassifiedSpan
+    {
+        // Partial opacity over variable alpha: nothing to specialize.
+        template<typename BlendFunction> static void blend(const Color* source, Color* dest, int count, ColorChannel opacity, BlendFunction f)
+        {
+            blendSpan(source, dest, count, opacity, f);
+        }
+    };
+
+    template<AlphaClass Alpha> struct ClassifiedSpan<OpacityZero, Alpha>
+    {
+        template<typename BlendFunction> static void blend(const Color* source, Color* dest, int count, ColorChannel opacity, BlendFunction f)
+        {
+            if(!BlendTraits<BlendFunction>::SkipsTransparent)
+            {
+                blendSpan(source, dest, count, opacity, f);
+            }
+        }
+    };
+
+    template<OpacityClass Opacity> struct ClassifiedSpan<Opacity, AlphaTransparent>
+    {
+        template<typename BlendFunction> static void blend(const Color* source, Color* dest, int count, ColorChannel opacity, BlendFunction f)
+        {
+            if(!BlendTraits<BlendFunction>::SkipsTransparent)
+            {
+                blendSpan(source, dest, count, opacity, f);
+            }
+        }
+    };
+
+    template<> struct ClassifiedSpan<OpacityZero, AlphaTransparent> : public ClassifiedSpan<OpacityZero, AlphaVariable> {};
+
+    template<> struct ClassifiedSpan<OpacityFull, AlphaOpaque>
+    {
+        template<typename BlendFunction> static void blend(const Color* source, Color* dest, int count, ColorChannel opacity, BlendFunction f)
+        {
+            if(BlendTraits<BlendFunction>::CopiesOpaque)
+            {
+                std::memmove(dest, source, count * sizeof(*dest));
+            }
+            else
+            {
+                blendSpanAs<simd::ConstantAlpha>(source, dest, count, opacity, f);
+            }
+        }
+    };
+
+    template<> struct ClassifiedSpan<OpacityPartial, AlphaOpaque>
+    {
+        template<typename BlendFunction> static void blend(const Color* source, Color* dest, int count, ColorChannel opacity, BlendFunction f)
+        {
+            blendSpanAs<simd::ConstantAlpha>(source, dest, count, opacity, f);
+        }
+    };
+
+    template<> struct ClassifiedSpan<OpacityFull, AlphaVariable>
+    {
+        template<typename BlendFunction> static void blend(const Color* source, Color* dest, int count, ColorChannel opacity, BlendFunction f)
+        {
+            blendSpanAs<simd::SourceAlpha>(source, dest, count, opacity, f);
+        }
+    };
+
+    // Binary alpha: skip the transparent runs, and treat the rest as opaque spans.
+    template<OpacityClass Opacity> struct ClassifiedSpan<Opacity, AlphaBinary>
+    {
+        template<typename BlendFunction> static void blend(const Color* source, Color* dest, int count, ColorChannel opacity, BlendFunction f)
+        {
+            int i = 0;
+            while(i < count)
+            {
+                int start = i;
+                bool transparent = source[i][AlphaChannel] == 0;
+                while(i < count && (source[i][AlphaChannel] == 0) == transparent)
+                {
+                    i++;
+                }
+                if(transparent)
+                {
+                    ClassifiedSpan<Opacity, AlphaTransparent>::blend(source + start, dest + start, i - start, opacity, f);
+                }
+                else
+                {
+                    ClassifiedSpan<Opacity, AlphaOpaque>::blend(source + start, dest + start, i - start, opacity, f);
+                }
+            }
+        }
+    };
+
+    template<> struct ClassifiedSpan<OpacityZero, AlphaBinary> : public ClassifiedSpan<OpacityZero, AlphaVariable> {};
+
+    // Blends a span with a known opacity class, after classifying the source alpha of the row.
+    template<OpacityClass Opacity, typename BlendFunction> void blendClassifiedSpan(const Color* source, Color* dest, int count, ColorChannel opacity, BlendFunction f)
+    {
+        switch(classifyAlpha(source, count))
+        {
+            case AlphaTransparent:
+                ClassifiedSpan<Opacity, AlphaTransparent>::blend(source, dest, count, opacity, f);
+                break;
+            case AlphaOpaque:
+                ClassifiedSpan<Opacity, AlphaOpaque>::blend(source, dest, count, opacity, f);
+                break;
+            case AlphaBinary:
+                ClassifiedSpan<Opacity, AlphaBinary>::blend(source, dest, count, opacity, f);
+                break;
+            default:
+                ClassifiedSpan<Opacity, AlphaVariable>::blend(source, dest, count, opacity, f);
+                break;
+        }
+    }
+
+    // Size of the stack buffers used to build source rows that don't exist
+    // in memory, such as resampled pixels.
+    enum { SpanBufferSize = 256 };
+
+    // Sets count dest pixels to color.
+    inline void fillSpan(Color color, Color* dest, int count)
+    {
+        int i = simd::fillWidest(color, dest, count);
+        for(; i < count; i++)
+        {
+            dest[i] = color;
+        }
+    }
+
+    // Blends a single colour over count dest pixels, as if f were called on each.
+    // Colours that the Blender's traits say skip or replace the dest don't blend
+    // at all, and the built-in Blenders run constant-source vector kernels.
+    // The premultiplied Blenders don't skip alpha 0, since such colours still add.
+    template<typename BlendFunction> void blendColorSpan(Color color, Color* dest, int count, ColorChannel opacity, BlendFunction f)
+    {
+        int alpha = simd::getColorAlpha(color, opacity);
+        if(BlendTraits<BlendFunction>::SkipsTransparent && alpha == 0)
+        {
+            return;
+        }
+        if(BlendTraits<BlendFunction>::CopiesOpaque && alpha == 255)
+        {
+            fillSpan(color, dest, count);
+            return;
+        }
+        int i = simd::runWidestColor<BlendFunction>(color, dest, count, opacity);
+        for(; i < count; i++)
+        {
+            dest[i] = f(color, dest[i], opacity);
+        }
+    }
+
+    inline void blendColorSpan(Color color, Color* dest, int count, ColorChannel, CopyBlender)
+    {
+        fillSpan(color, dest, count);
+    }
+}
+
+#endif
\ No newline at end of file
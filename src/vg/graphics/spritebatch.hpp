@@ -0,0 +1,343 @@
+#ifndef VG_GRAPHICS_SPRITEBATCH_HPP
+#define VG_GRAPHICS_SPRITEBATCH_HPP
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include "blend.hpp"
+#include "color.hpp"
+#include "image.hpp"
+#include "atlas.hpp"
+#include "dispatch.hpp"
+
+namespace vg
+{
+    // Collects lots of small draws onto a target Image, and draws them all in
+    // one flush. The flush clips every sprite to the target's clipping region
+    // and culls the ones that can't change anything in one pass, then groups
+    // them by source and blend mode, so each group picks its Blender and reads
+    // its source's alpha metadata once. With a worker pool on the target
+    // (Image::setWorkerPool) the target is split into bands of rows drawn in
+    // parallel.
+    //
+    // Sprites in a group are drawn in the order they were added, and groups in
+    // the order their first sprites were, but the groups go one after another,
+    // so where sprites of different groups overlap, the one on top may change.
+    // Flush between layers that have to stack in order.
+    // Clipping uses the target's clipping region at flush time, and source
+    // pixels are read then too, so they mustn't change until the flush.
+    class SpriteBatch
+    {
+        private:
+            struct Sprite
+            {
+                Image* source;
+                int sourceX, sourceY, sourceX2, sourceY2;
+                int destX, destY;
+                BlendMode mode;
+                ColorChannel opacity;
+                OpacityClass opacityClass;
+                // Which group the sprite draws in, numbered by where the group's
+                // first sprite was added.
+                size_t group;
+            };
+
+            // Orders sprites by group, keeping the order they were added otherwise.
+            struct GroupOrder
+            {
+                bool operator()(const Sprite& a, const Sprite& b) const
+                {
+                    return a.group < b.group;
+                }
+            };
+
+            // A run of sprites added with the same source and mode, from start on.
+            struct Run
+            {
+                Image* source;
+                BlendMode mode;
+                size_t start;
+                size_t group;
+            };
+
+            // Brings runs with the same source and mode together, each lot earliest first.
+            // The order between lots doesn't matter, so comparing addresses is fine.
+            struct RunOrder
+            {
+                bool operator()(const Run& a, const Run& b) const
+                {
+                    if(a.source != b.source)
+                    {
+                        return std::less<Image*>()(a.source, b.source);
+                    }
+                    if(a.mode != b.mode)
+                    {
+                        return a.mode < b.mode;
+                    }
+                    return a.start < b.start;
+                }
+            };
+
+            struct RunStartOrder
+            {
+                bool operator()(const Run& a, const Run& b) const
+                {
+                    return a.start < b.start;
+                }
+            };
+
+            // Draws the rows of count sprites that fall in bandY..bandY2.
+            static void drawBand(const Sprite* sprites, size_t count, int bandY, int bandY2, Image* target)
+            {
+                const BlendOperations* operations = getBlendOperations(sprites->mode);
+                for(size_t i = 0; i < count; i++)
+                {
+                    const Sprite& sprite = sprites[i];
+                    int y = std::max(sprite.destY, bandY);
+                    int y2 = std::min(sprite.destY + sprite.sourceY2 - sprite.sourceY, bandY2);
+                    if(y > y2)
+                    {
+                        continue;
+                    }
+
+                    int sourceY = sprite.sourceY + y - sprite.destY;
+                    int sourceY2 = sourceY + y2 - y;
+                    operations->blendRows(sprite.source, sprite.sourceX, sourceY, sprite.sourceX2, sourceY2,
+                        sprite.destX, y, target, sprite.opacity, sprite.opacityClass);
+                }
+            }
+
+            Image* target;
+            std::vector<Sprite> sprites;
+            // Kept between flushes, so a steady batch doesn't allocate.
+            std::vector<Sprite> visible;
+            std::vector<Run> runs;
+            std::vector<size_t> groupStarts;
+
+        public:
+            SpriteBatch(Image* target):
+                target(target)
+            {
+            }
+
+            Image* getTarget() const
+            {
+                return target;
+            }
+
+            int getSpriteCount() const
+            {
+                return int(sprites.size());
+            }
+
+            // Throws away the queued sprites without drawing them.
+            void clear()
+            {
+                sprites.clear();
+            }
+
+            // Queues the region sourceX, sourceY - sourceX2, sourceY2 of source, to be
+            // drawn at destX, destY with the given blend mode and opacity.
+            void drawRegion(Image* source, int sourceX, int sourceY, int sourceX2, int sourceY2,
+                int destX, int destY, BlendMode mode, ColorChannel opacity)
+            {
+                const BlendOperations* operations = getBlendOperations(mode);
+                if(!operations)
+                {
+                    return;
+                }
+
+                // Same rules for the source rectangle as Image::drawRegion, which
+                // draws nothing from an empty view.
+                if(source->getWidth() == 0 || source->getHeight() == 0)
+                {
+                    return;
+                }
+                Sprite sprite;
+                sprite.source = source;
+                sprite.sourceX = std::min(std::max(0, sourceX), source->getWidth() - 1);
+                sprite.sourceY = std::min(std::max(0, sourceY), source->getHeight() - 1);
+                sprite.sourceX2 = std::min(std::max(0, sourceX2), source->getWidth() - 1);
+                sprite.sourceY2 = std::min(std::max(0, sourceY2), source->getHeight() - 1);
+                if(sprite.sourceX > sprite.sourceX2)
+                {
+                    std::swap(sprite.sourceX, sprite.sourceX2);
+                }
+                if(sprite.sourceY > sprite.sourceY2)
+                {
+                    std::swap(sprite.sourceY, sprite.sourceY2);
+                }
+                sprite.destX = destX;
+                sprite.destY = destY;
+                sprite.mode = mode;
+                sprite.opacity = opacity;
+
+                // Reading the target while the batch writes to it won't work, so draw it now.
+                if(source->sharesPixels(target))
+                {
+                    flush();
+                    operations->drawRegionAtOpacity(sprite.source, sprite.sourceX, sprite.sourceY, sprite.sourceX2, sprite.sourceY2,
+                        sprite.destX, sprite.destY, target, sprite.opacity);
+                    return;
+                }
+                sprites.push_back(sprite);
+            }
+
+            // Queues a region at the source image's opacity.
+            void drawRegion(Image* source, int sourceX, int sourceY, int sourceX2, int sourceY2,
+                int destX, int destY, BlendMode mode)
+            {
+                drawRegion(source, sourceX, sourceY, sourceX2, sourceY2, destX, destY, mode, source->getOpacity());
+            }
+
+            void draw(Image* source, int x, int y, BlendMode mode, ColorChannel opacity)
+            {
+                drawRegion(source, 0, 0, source->getWidth() - 1, source->getHeight() - 1, x, y, mode, opacity);
+            }
+
+            void draw(Image* source, int x, int y, BlendMode mode)
+            {
+                draw(source, x, y, mode, source->getOpacity());
+            }
+
+            // Queues an atlas sprite, as if drawing the untrimmed original.
+            void draw(const AtlasRegion& region, int x, int y, BlendMode mode, ColorChannel opacity)
+            {
+                if(region.image)
+                {
+                    drawRegion(region.image, region.x, region.y, region.x2, region.y2, x + region.offsetX, y + region.offsetY, mode, opacity);
+                }
+            }
+
+            void draw(const AtlasRegion& region, int x, int y, BlendMode mode)
+            {
+                if(region.image)
+                {
+                    draw(region, x, y, mode, region.image->getOpacity());
+                }
+            }
+
+            // Draws every queued sprite onto the target, then clears the batch.
+            void flush()
+            {
+                if(sprites.empty())
+                {
+                    return;
+                }
+
+                int clipX, clipY, clipX2, clipY2;
+                target->getClip(clipX, clipY, clipX2, clipY2);
+
+                // Clip everything to the target, and drop what can't draw anything.
+                visible.clear();
+                runs.clear();
+                long long area = 0;
+                // Whether the last source and mode seen can leave pixels alone, looked up once per run of them.
+                const Sprite* last = 0;
+                bool skipsTransparent = false;
+                bool sourceTransparent = false;
+                for(size_t i = 0; i < sprites.size(); i++)
+                {
+                    Sprite sprite = sprites[i];
+                    if(!last || last->source != sprite.source || last->mode != sprite.mode)
+                    {
+                        skipsTransparent = getBlendOperations(sprite.mode)->skipsTransparent;
+                        sourceTransparent = skipsTransparent && sprite.source->getAlphaClass() == AlphaTransparent;
+                        last = &sprites[i];
+                        Run run = {sprite.source, sprite.mode, i, i};
+                        runs.push_back(run);
+                    }
+                    // For now, the run the sprite is in.
+                    sprite.group = runs.size() - 1;
+                    if(sourceTransparent || (skipsTransparent && sprite.opacity == 0))
+                    {
+                        continue;
+                    }
+
+                    int destX2 = sprite.destX + sprite.sourceX2 - sprite.sourceX;
+                    int destY2 = sprite.destY + sprite.sourceY2 - sprite.sourceY;
+                    if(sprite.destX > clipX2 || destX2 < clipX || sprite.destY > clipY2 || destY2 < clipY)
+                    {
+                        continue;
+                    }
+                    if(sprite.destX < clipX)
+                    {
+                        sprite.sourceX += clipX - sprite.destX;
+                        sprite.destX = clipX;
+                    }
+                    if(destX2 > clipX2)
+                    {
+                        sprite.sourceX2 -= destX2 - clipX2;
+                        destX2 = clipX2;
+                    }
+                    if(sprite.destY < clipY)
+                    {
+                        sprite.sourceY += clipY - sprite.destY;
+                        sprite.destY = clipY;
+                    }
+                    if(destY2 > clipY2)
+                    {
+                        sprite.sourceY2 -= destY2 - clipY2;
+                        destY2 = clipY2;
+                    }
+
+                    // Copy ignores opacity, as in Image::drawRegion.
+                    sprite.opacityClass = sprite.mode == BlendCopy ? OpacityFull : classifyOpacity(sprite.opacity);
+                    target->modified(sprite.destX, sprite.destY, destX2, destY2);
+                    area += (long long) (destX2 - sprite.destX + 1) * (destY2 - sprite.destY + 1);
+                    visible.push_back(sprite);
+                }
+                sprites.clear();
+                if(visible.empty())
+                {
+                    return;
+                }
+
+                // Batches usually come in runs of the same sprite already, so only sort if
+                // a source and mode come back after something else. Then their group is
+                // the one they were first added in.
+                std::sort(runs.begin(), runs.end(), RunOrder());
+                bool regroup = false;
+                for(size_t i = 1; i < runs.size(); i++)
+                {
+                    if(runs[i].source == runs[i - 1].source && runs[i].mode == runs[i - 1].mode)
+                    {
+                        runs[i].group = runs[i - 1].group;
+                        regroup = true;
+                    }
+                }
+                std::sort(runs.begin(), runs.end(), RunStartOrder());
+                for(size_t i = 0; i < visible.size(); i++)
+                {
+                    visible[i].group = runs[visible[i].group].group;
+                }
+                if(regroup)
+                {
+                    std::stable_sort(visible.begin(), visible.end(), GroupOrder());
+                }
+                groupStarts.clear();
+                for(size_t i = 0; i < visible.size(); i++)
+                {
+                    if(i == 0 || visible[i].group != visible[i - 1].group)
+                    {
+                        groupStarts.push_back(i);
+                    }
+                }
+                groupStarts.push_back(visible.size());
+
+                // Bands only write their own rows, so each can draw every group in turn.
+                int rows = clipY2 - clipY + 1;
+                int columns = int(std::min(area / rows + 1, (long long) clipX2 - clipX + 1));
+                target->forEachBand(clipY, clipY2, columns, [&](int bandY, int bandY2)
+                {
+                    for(size_t i = 0; i + 1 < groupStarts.size(); i++)
+                    {
+                        const Sprite* group = &visible[groupStarts[i]];
+                        drawBand(group, groupStarts[i + 1] - groupStarts[i], bandY, bandY2, target);
+                    }
+                });
+            }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,112 @@
+#ifndef VG_GRAPHICS_TRANSFORM_HPP
+#define VG_GRAPHICS_TRANSFORM_HPP
+
+#include <cmath>
+
+namespace vg
+{
+    // A 2D affine transform, taking a point x, y to
+    // (a * x + c * y + tx, b * x + d * y + ty).
+    //
+    // Build one up from the named transforms with then(), which applies them in
+    // the order they're written. For a sprite turned about a pivot point:
+    //
+    //     Transform2D::translation(-pivotX, -pivotY)
+    //         .then(Transform2D::rotation(angle))
+    //         .then(Transform2D::translation(x, y))
+    struct Transform2D
+    {
+        double a, b, c, d;
+        double tx, ty;
+
+        static Transform2D identity()
+        {
+            Transform2D result = {1, 0, 0, 1, 0, 0};
+            return result;
+        }
+
+        static Transform2D translation(double x, double y)
+        {
+            Transform2D result = {1, 0, 0, 1, x, y};
+            return result;
+        }
+
+        // A negative scale flips along that axis.
+        static Transform2D scaling(double x, double y)
+        {
+            Transform2D result = {x, 0, 0, y, 0, 0};
+            return result;
+        }
+
+        // Turns by angle radians, clockwise on screen, since y points down.
+        static Transform2D rotation(double angle)
+        {
+            double cosine = std::cos(angle);
+            double sine = std::sin(angle);
+            Transform2D result = {cosine, sine, -sine, cosine, 0, 0};
+            return result;
+        }
+
+        // Moves x by x * y, and y by y * x.
+        static Transform2D shearing(double x, double y)
+        {
+            Transform2D result = {1, y, x, 1, 0, 0};
+            return result;
+        }
+
+        // This transform, followed by next.
+        Transform2D then(const Transform2D& next) const
+        {
+            Transform2D result = {
+                next.a * a + next.c * b,
+                next.b * a + next.d * b,
+                next.a * c + next.c * d,
+                next.b * c + next.d * d,
+                next.a * tx + next.c * ty + next.tx,
+                next.b * tx + next.d * ty + next.ty
+            };
+            return result;
+        }
+
+        double getDeterminant() const
+        {
+            return a * d - b * c;
+        }
+
+        // Whether the transform has an inverse, which it needs to draw anything.
+        bool isInvertible() const
+        {
+            double determinant = getDeterminant();
+            return determinant != 0 && determinant == determinant;
+        }
+
+        // The transform that undoes this one. Only meaningful if isInvertible().
+        Transform2D inverted() const
+        {
+            double determinant = getDeterminant();
+            Transform2D result = {
+                d / determinant,
+                -b / determinant,
+                -c / determinant,
+                a / determinant,
+                (c * ty - d * tx) / determinant,
+                (b * tx - a * ty) / determinant
+            };
+            return result;
+        }
+
+        // No rotation or shear, so rectangles stay lined up with the axes.
+        bool isAxisAligned() const
+        {
+            return b == 0 && c == 0;
+        }
+
+        void apply(double x, double y, double& resultX, double& resultY) const
+        {
+            resultX = a * x + c * y + tx;
+            resultY = b * x + d * y + ty;
+        }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,322 @@
+#ifndef VG_GRAPHICS_VGI_HPP
+#define VG_GRAPHICS_VGI_HPP
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <zlib/zlib.h>
+#include "blend.hpp"
+#include "color.hpp"
+#include "span.hpp"
+#include "image.hpp"
+#include "../core/mappedfile.hpp"
+
+namespace vg
+{
+    // The start of a .vgi file, which holds an image the way Image keeps it in
+    // memory: BGRA Colors, rows Image::getAlignedPitch(width) pixels apart, the
+    // first row on an Image::RowAlignment boundary. All fields are little-endian.
+    //
+    // After the header comes an optional alpha table, a VgiAlphaRow for each
+    // row, then the pixels. Compressed files hold the rows zlib-compressed,
+    // width pixels each, without the padding out to the pitch.
+    struct VgiHeader
+    {
+        enum { Version = 1 };
+        enum { Compressed = 1, HasAlphaTable = 2, Premultiplied = 4 };
+
+        // "VGI" and a zero.
+        char magic[4];
+        unsigned int version;
+        unsigned int width, height;
+        // Pixels from one row to the next.
+        unsigned int pitch;
+        unsigned int flags;
+        // Where the alpha table and pixels start, in bytes from the start of the file.
+        unsigned int alphaTableOffset;
+        unsigned int pixelOffset;
+        // The pixels' size in the file, compressed or not.
+        unsigned int pixelBytes;
+        unsigned int reserved[7];
+    };
+
+    // An AlphaRowInfo, at a fixed size for the file.
+    struct VgiAlphaRow
+    {
+        int alphaClass;
+        int left, right;
+        int opaqueLeft, opaqueRight;
+    };
+
+    // An Image whose pixels are the pages of a mapped .vgi file, so loading one
+    // copies nothing. Pixels are read in from the file as they're first touched,
+    // and writing to them makes private copies of the pages written, leaving the
+    // file alone.
+    class MappedImage : public Image
+    {
+        private:
+            AbstractMappedFile* file;
+
+        public:
+            // Takes over the file, which stays mapped until the image is deleted.
+            MappedImage(AbstractMappedFile* file, int width, int height, Color* data, int pitch):
+                Image(width, height, data, pitch),
+                file(file)
+            {
+            }
+
+            ~MappedImage()
+            {
+                delete file;
+            }
+    };
+
+    // Loads and saves .vgi files, the engine's own image format, meant to be
+    // made from PNGs and such ahead of time so that loading them at startup
+    // has nothing to decode. Uncompressed files are mapped into memory and
+    // used in place, as MappedImages. Compressed ones are smaller on disk, and
+    // are inflated straight into a new Image's rows.
+    //
+    // With an alpha table, images arrive with their alpha metadata filled in,
+    // so the first draw doesn't have to scan every pixel for it.
+    class VgiFile
+    {
+        private:
+            // Larger images are refused outright, rather than trusting the header.
+            enum { MaxPixels = 1 << 28 };
+            // How much compressed data is written to a file at a time.
+            enum { OutputBufferSize = 64 * 1024 };
+
+            static size_t getAlphaTableBytes(int height)
+            {
+                return size_t(height) * sizeof(VgiAlphaRow);
+            }
+
+            static size_t alignOffset(size_t offset)
+            {
+                return (offset + Image::RowAlignment - 1) / Image::RowAlignment * Image::RowAlignment;
+            }
+
+            // Checks the header against the file it came from, so nothing past the end gets read.
+            static bool checkHeader(const VgiHeader& header, size_t fileSize)
+            {
+                if(std::memcmp(header.magic, "VGI", 4) != 0 || header.version != VgiHeader::Version)
+                {
+                    return false;
+                }
+                if(header.width == 0 || header.height == 0 || header.width > MaxPixels || header.height > MaxPixels
+                    || (unsigned long long) header.width * header.height > MaxPixels
+                    || header.pitch != (unsigned int) Image::getAlignedPitch(int(header.width)))
+                {
+                    return false;
+                }
+                if((header.flags & VgiHeader::HasAlphaTable)
+                    && (header.alphaTableOffset > fileSize || getAlphaTableBytes(header.height) > fileSize - header.alphaTableOffset))
+                {
+                    return false;
+                }
+                if(header.pixelOffset % Image::RowAlignment != 0 || header.pixelOffset > fileSize || header.pixelBytes > fileSize - header.pixelOffset)
+                {
+                    return false;
+                }
+                return (header.flags & VgiHeader::Compressed) != 0
+                    || header.pixelBytes == (unsigned long long) header.pitch * header.height * sizeof(Color);
+            }
+
+            // Hands the alpha table to the image, unless it doesn't fit the image, in which case it's worked out later as usual.
+            static void loadAlphaTable(Image* image, const unsigned char* table)
+            {
+                int width = image->getWidth();
+                int height = image->getHeight();
+                std::vector<AlphaRowInfo> rows(height);
+                for(int y = 0; y < height; y++)
+                {
+                    VgiAlphaRow row;
+                    std::memcpy(&row, table + y * sizeof(VgiAlphaRow), sizeof(VgiAlphaRow));
+                    if(row.alphaClass < AlphaTransparent || row.alphaClass > AlphaVariable
+                        || (row.left <= row.right && (row.left < 0 || row.right >= width))
+                        || (row.opaqueLeft <= row.opaqueRight && (row.opaqueLeft < 0 || row.opaqueRight >= width)))
+                    {
+                        return;
+                    }
+                    AlphaRowInfo info = {AlphaClass(row.alphaClass), row.left, row.right, row.opaqueLeft, row.opaqueRight};
+                    rows[y] = info;
+                }
+                image->setAlphaInfo(&rows[0]);
+            }
+
+            // Inflates the rows of a compressed file into a new image.
+            static Image* inflatePixels(const VgiHeader& header, const unsigned char* pixels)
+            {
+                z_stream stream;
+                std::memset(&stream, 0, sizeof(stream));
+                if(inflateInit(&stream) != Z_OK)
+                {
+                    return 0;
+                }
+                stream.next_in = (Bytef*) pixels;
+                stream.avail_in = header.pixelBytes;
+
+                // No need to clear the pixels, since every row gets written.
+                Image* image = new Image(int(header.width), int(header.height), 0);
+                bool success = true;
+                for(int y = 0; y < image->height && success; y++)
+                {
+                    stream.next_out = (Bytef*) (image->data + y * image->pitch);
+                    stream.avail_out = header.width * sizeof(Color);
+                    int result = inflate(&stream, Z_NO_FLUSH);
+                    success = (result == Z_OK || result == Z_STREAM_END) && stream.avail_out == 0;
+                }
+                inflateEnd(&stream);
+
+                if(!success)
+                {
+                    delete image;
+                    return 0;
+                }
+                return image;
+            }
+
+            static bool writeRows(FILE* file, const Image* image, VgiHeader& header)
+            {
+                const Color* data = image->getRawData();
+                size_t rowBytes = image->getWidth() * sizeof(Color);
+                if(!(header.flags & VgiHeader::Compressed))
+                {
+                    // Pad each row out to the pitch.
+                    std::vector<Color> padding(header.pitch - image->getWidth(), Color(0u));
+                    for(int y = 0; y < image->getHeight(); y++)
+                    {
+                        if(fwrite(data + y * image->getPitch(), 1, rowBytes, file) != rowBytes
+                            || (!padding.empty() && fwrite(&padding[0], sizeof(Color), padding.size(), file) != padding.size()))
+                        {
+                            return false;
+                        }
+                    }
+                    header.pixelBytes = header.pitch * header.height * sizeof(Color);
+                    return true;
+                }
+
+                z_stream stream;
+                std::memset(&stream, 0, sizeof(stream));
+                if(deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK)
+                {
+                    return false;
+                }
+                std::vector<unsigned char> output(OutputBufferSize);
+                bool success = true;
+                for(int y = 0; y < image->getHeight() && success; y++)
+                {
+                    stream.next_in = (Bytef*) (data + y * image->getPitch());
+                    stream.avail_in = uInt(rowBytes);
+                    int flush = y == image->getHeight() - 1 ? Z_FINISH : Z_NO_FLUSH;
+                    int result;
+                    do
+                    {
+                        stream.next_out = &output[0];
+                        stream.avail_out = uInt(output.size());
+                        result = deflate(&stream, flush);
+                        size_t bytes = output.size() - stream.avail_out;
+                        success = result != Z_STREAM_ERROR && fwrite(&output[0], 1, bytes, file) == bytes;
+                    }
+                    while(success && stream.avail_out == 0);
+                }
+                header.pixelBytes = (unsigned int) stream.total_out;
+                deflateEnd(&stream);
+                return success;
+            }
+
+        public:
+            // Returns null if the file can't be loaded, or a new Image the caller owns.
+            static Image* load(const char* filename)
+            {
+                AbstractMappedFile* file = new MappedFile(filename);
+                const unsigned char* contents = file->getData();
+                VgiHeader header;
+                if(!contents || file->getSize() < sizeof(VgiHeader))
+                {
+                    delete file;
+                    return 0;
+                }
+                std::memcpy(&header, contents, sizeof(VgiHeader));
+                if(!checkHeader(header, file->getSize()))
+                {
+                    delete file;
+                    return 0;
+                }
+
+                Image* image;
+                if(header.flags & VgiHeader::Compressed)
+                {
+                    // The mapping is only needed to inflate from.
+                    image = inflatePixels(header, contents + header.pixelOffset);
+                    if(!image)
+                    {
+                        delete file;
+                        return 0;
+                    }
+                }
+                else
+                {
+                    image = new MappedImage(file, int(header.width), int(header.height),
+                        (Color*) (file->getData() + header.pixelOffset), int(header.pitch));
+                }
+
+                image->premultiplied = (header.flags & VgiHeader::Premultiplied) != 0;
+                if(header.flags & VgiHeader::HasAlphaTable)
+                {
+                    loadAlphaTable(image, contents + header.alphaTableOffset);
+                }
+                if(header.flags & VgiHeader::Compressed)
+                {
+                    delete file;
+                }
+                return image;
+            }
+
+            // Writes an image out, with the pixels compressed if compressed is set,
+            // and an alpha table if alphaTable is. Returns false if it couldn't.
+            static bool save(const Image* image, const char* filename, bool compressed = false, bool alphaTable = true)
+            {
+                VgiHeader header;
+                std::memset(&header, 0, sizeof(header));
+                std::memcpy(header.magic, "VGI", 4);
+                header.version = VgiHeader::Version;
+                header.width = image->getWidth();
+                header.height = image->getHeight();
+                header.pitch = Image::getAlignedPitch(image->getWidth());
+                header.flags = (compressed ? VgiHeader::Compressed : 0)
+                    | (alphaTable ? VgiHeader::HasAlphaTable : 0)
+                    | (image->isPremultiplied() ? VgiHeader::Premultiplied : 0);
+                header.alphaTableOffset = alphaTable ? sizeof(VgiHeader) : 0;
+                header.pixelOffset = (unsigned int) alignOffset(sizeof(VgiHeader) + (alphaTable ? getAlphaTableBytes(image->getHeight()) : 0));
+
+                FILE* file = fopen(filename, "wb");
+                if(!file)
+                {
+                    return false;
+                }
+                // The header goes in last, once the size of the pixels is known.
+                std::vector<unsigned char> start(header.pixelOffset, 0);
+                for(int y = 0; alphaTable && y < image->getHeight(); y++)
+                {
+                    const AlphaRowInfo& info = image->getAlphaRowInfo(y);
+                    VgiAlphaRow row = {info.alphaClass, info.left, info.right, info.opaqueLeft, info.opaqueRight};
+                    std::memcpy(&start[header.alphaTableOffset + y * sizeof(VgiAlphaRow)], &row, sizeof(VgiAlphaRow));
+                }
+                bool success = fwrite(&start[0], 1, start.size(), file) == start.size()
+                    && writeRows(file, image, header)
+                    && fseek(file, 0, SEEK_SET) == 0
+                    && fwrite(&header, sizeof(header), 1, file) == 1;
+                success = fclose(file) == 0 && success;
+                if(!success)
+                {
+                    remove(filename);
+                }
+                return success;
+            }
+    };
+}
+
+#endif
\ No newline at end of file
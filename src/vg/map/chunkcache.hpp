@@ -0,0 +1,270 @@
+#ifndef VG_MAP_CHUNKCACHE_HPP
+#define VG_MAP_CHUNKCACHE_HPP
+
+#include <vector>
+#include <algorithm>
+#include "../graphics/blend.hpp"
+#include "../graphics/color.hpp"
+#include "../graphics/image.hpp"
+#include "tilemap.hpp"
+
+namespace vg
+{
+    // Keeps a group of static map layers pre-rendered in big chunks, so drawing
+    // them is a handful of chunk draws a frame, rather than a draw per tile.
+    //
+    // Chunks are rendered when they first come into view, and stay until a tile
+    // under them changes or the memory budget runs out, at which point the ones
+    // seen least recently go first. The budget only holds back chunks that
+    // aren't in view, so a viewport bigger than the budget still draws.
+    //
+    // Layers are merged onto transparent chunks, and the chunks are drawn with
+    // the Blender passed to render. With MergeBlender that gives the same
+    // picture as drawing the layers one by one, give or take rounding where
+    // translucent tiles overlap. Other Blenders apply to the layers flattened
+    // together, so AddBlender adds the merged layers once. Chunks that came out
+    // fully opaque are drawn with CopyBlender when the Blender would copy them.
+    class TileChunkCache
+    {
+        private:
+            struct Chunk
+            {
+                Image* image;
+                bool valid;
+                bool opaque;
+                unsigned int lastUsed;
+            };
+
+            Tilemap* map;
+            int firstLayer, lastLayer;
+            // Chunk size, in pixels, a whole number of tiles.
+            int chunkWidth, chunkHeight;
+            int chunksX, chunksY;
+            std::vector<Chunk> chunks;
+            size_t budgetBytes;
+            size_t allocatedBytes;
+            unsigned int frame;
+
+            static int divideDown(int a, int b)
+            {
+                return a >= 0 ? a / b : -((b - 1 - a) / b);
+            }
+
+            static size_t getBytes(const Image* image)
+            {
+                return size_t(image->getPitch()) * image->getHeight() * sizeof(Color);
+            }
+
+            // The chunk holding an image that's been out of view the longest, or null if they're all in view.
+            Chunk* findLeastRecentlyUsed()
+            {
+                Chunk* oldest = 0;
+                for(size_t i = 0; i < chunks.size(); i++)
+                {
+                    Chunk& chunk = chunks[i];
+                    if(chunk.image && chunk.lastUsed != frame && (!oldest || chunk.lastUsed < oldest->lastUsed))
+                    {
+                        oldest = &chunk;
+                    }
+                }
+                return oldest;
+            }
+
+            void freeChunk(Chunk& chunk)
+            {
+                allocatedBytes -= getBytes(chunk.image);
+                delete chunk.image;
+                chunk.image = 0;
+                chunk.valid = false;
+            }
+
+            // Gets a chunk ready to draw, reusing the oldest chunk's image when over budget.
+            void prepare(int chunkX, int chunkY)
+            {
+                Chunk& chunk = chunks[chunkY * chunksX + chunkX];
+                chunk.lastUsed = frame;
+                if(chunk.valid)
+                {
+                    return;
+                }
+
+                if(!chunk.image)
+                {
+                    size_t bytes = size_t(Image::getAlignedPitch(chunkWidth)) * chunkHeight * sizeof(Color);
+                    Chunk* oldest = allocatedBytes + bytes > budgetBytes ? findLeastRecentlyUsed() : 0;
+                    if(oldest)
+                    {
+                        chunk.image = oldest->image;
+                        oldest->image = 0;
+                        oldest->valid = false;
+                    }
+                    else
+                    {
+                        // Left uninitialized, since it's cleared below either way.
+                        chunk.image = new Image(chunkWidth, chunkHeight, 0);
+                        allocatedBytes += getBytes(chunk.image);
+                    }
+                }
+
+                Image* image = chunk.image;
+                int left = chunkX * chunkWidth;
+                int top = chunkY * chunkHeight;
+                image->clear(Color(0u));
+                map->renderLayers(firstLayer, lastLayer, image, left, top, MergeBlender());
+
+                // Opaque if every row is one opaque run across the part inside the map.
+                int width = getDrawWidth(chunkX);
+                int height = getDrawHeight(chunkY);
+                chunk.opaque = true;
+                for(int y = 0; y < height && chunk.opaque; y++)
+                {
+                    const AlphaRowInfo& info = image->getAlphaRowInfo(y);
+                    chunk.opaque = info.opaqueLeft == 0 && info.opaqueRight >= width - 1;
+                }
+                chunk.valid = true;
+            }
+
+            // How much of a chunk on the right or bottom edge is inside the map.
+            int getDrawWidth(int chunkX) const
+            {
+                return std::min(chunkWidth, map->getWidth() * map->getTileset()->getTileWidth() - chunkX * chunkWidth);
+            }
+
+            int getDrawHeight(int chunkY) const
+            {
+                return std::min(chunkHeight, map->getHeight() * map->getTileset()->getTileHeight() - chunkY * chunkHeight);
+            }
+
+        public:
+            // Caches layers firstLayer..lastLayer of map, in chunks of about chunkSize
+            // pixels square, keeping no more than budgetBytes of chunks out of view.
+            TileChunkCache(Tilemap* map, int firstLayer, int lastLayer, size_t budgetBytes, int chunkSize = 256):
+                map(map),
+                firstLayer(firstLayer),
+                lastLayer(lastLayer),
+                budgetBytes(budgetBytes),
+                allocatedBytes(0),
+                frame(0)
+            {
+                int tileWidth = map->getTileset()->getTileWidth();
+                int tileHeight = map->getTileset()->getTileHeight();
+                chunkWidth = std::max(chunkSize / tileWidth, 1) * tileWidth;
+                chunkHeight = std::max(chunkSize / tileHeight, 1) * tileHeight;
+                chunksX = (map->getWidth() * tileWidth + chunkWidth - 1) / chunkWidth;
+                chunksY = (map->getHeight() * tileHeight + chunkHeight - 1) / chunkHeight;
+                Chunk empty = {0, false, false, 0};
+                chunks.resize(chunksX * chunksY, empty);
+            }
+
+            ~TileChunkCache()
+            {
+                clear();
+            }
+
+            // Sets a tile in one of the map's layers, and throws away the chunk it's in if it's cached here.
+            void setTile(int layer, int x, int y, int tile)
+            {
+                TileLayer* tiles = map->getLayer(layer);
+                if(tiles->getTile(x, y) != tile)
+                {
+                    tiles->setTile(x, y, tile);
+                    if(layer >= firstLayer && layer <= lastLayer)
+                    {
+                        invalidate(x, y, x, y);
+                    }
+                }
+            }
+
+            // Marks the chunks over tiles x, y - x2, y2 for re-rendering, for edits
+            // made to the layers directly. Their images are kept for reuse.
+            void invalidate(int x, int y, int x2, int y2)
+            {
+                int tileWidth = map->getTileset()->getTileWidth();
+                int tileHeight = map->getTileset()->getTileHeight();
+                int chunkX = std::max(std::min(x, x2) * tileWidth / chunkWidth, 0);
+                int chunkY = std::max(std::min(y, y2) * tileHeight / chunkHeight, 0);
+                int chunkX2 = std::min(std::max(x, x2) * tileWidth / chunkWidth, chunksX - 1);
+                int chunkY2 = std::min(std::max(y, y2) * tileHeight / chunkHeight, chunksY - 1);
+                for(int j = chunkY; j <= chunkY2; j++)
+                {
+                    for(int i = chunkX; i <= chunkX2; i++)
+                    {
+                        chunks[j * chunksX + i].valid = false;
+                    }
+                }
+            }
+
+            // Marks every chunk for re-rendering, for when the tileset changes.
+            void invalidateAll()
+            {
+                for(size_t i = 0; i < chunks.size(); i++)
+                {
+                    chunks[i].valid = false;
+                }
+            }
+
+            // Frees every chunk.
+            void clear()
+            {
+                for(size_t i = 0; i < chunks.size(); i++)
+                {
+                    if(chunks[i].image)
+                    {
+                        freeChunk(chunks[i]);
+                    }
+                }
+            }
+
+            size_t getAllocatedBytes() const
+            {
+                return allocatedBytes;
+            }
+
+            // Draws the layers into the target's clipping region, with the map's top left
+            // corner at -cameraX, -cameraY, as Tilemap::renderLayer does.
+            template<typename BlendFunction> void render(Image* dest, int cameraX, int cameraY, BlendFunction f)
+            {
+                frame++;
+                int clipX, clipY, clipX2, clipY2;
+                dest->getClip(clipX, clipY, clipX2, clipY2);
+                int chunkX = std::max(divideDown(clipX + cameraX, chunkWidth), 0);
+                int chunkY = std::max(divideDown(clipY + cameraY, chunkHeight), 0);
+                int chunkX2 = std::min(divideDown(clipX2 + cameraX, chunkWidth), chunksX - 1);
+                int chunkY2 = std::min(divideDown(clipY2 + cameraY, chunkHeight), chunksY - 1);
+
+                for(int j = chunkY; j <= chunkY2; j++)
+                {
+                    for(int i = chunkX; i <= chunkX2; i++)
+                    {
+                        prepare(i, j);
+                        const Chunk& chunk = chunks[j * chunksX + i];
+                        int destX = i * chunkWidth - cameraX;
+                        int destY = j * chunkHeight - cameraY;
+                        int width = getDrawWidth(i);
+                        int height = getDrawHeight(j);
+                        if(chunk.opaque && BlendTraits<BlendFunction>::CopiesOpaque)
+                        {
+                            chunk.image->drawRegion(0, 0, width - 1, height - 1, destX, destY, dest, CopyBlender());
+                        }
+                        else
+                        {
+                            chunk.image->drawRegion(0, 0, width - 1, height - 1, destX, destY, dest, f);
+                        }
+                    }
+                }
+
+                // Bring what's out of view back under budget.
+                while(allocatedBytes > budgetBytes)
+                {
+                    Chunk* oldest = findLeastRecentlyUsed();
+                    if(!oldest)
+                    {
+                        break;
+                    }
+                    freeChunk(*oldest);
+                }
+            }
+    };
+}
+
+#endif
\ No newline at end of file
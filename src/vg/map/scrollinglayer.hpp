@@ -0,0 +1,195 @@
+#ifndef VG_MAP_SCROLLINGLAYER_HPP
+#define VG_MAP_SCROLLINGLAYER_HPP
+
+#include <cstdlib>
+#include <algorithm>
+#include "../graphics/blend.hpp"
+#include "../graphics/color.hpp"
+#include "../graphics/image.hpp"
+
+namespace vg
+{
+    // Keeps a screen-sized window of a scrolling layer rendered, so moving the
+    // camera a few pixels only renders the strips that come into view, not the
+    // whole screen. Give each parallax layer its own, with its own camera.
+    //
+    // The pixels live in a ring buffer: world pixel x, y is kept at x mod width,
+    // y mod height, so the part still in view never moves, and drawing the
+    // window out is two or four drawRegion calls where it wraps around.
+    //
+    // Layers are drawn by a render function, called as render(target, cameraX, cameraY),
+    // which should draw the world into the target's clipping region with the world's
+    // top left at -cameraX, -cameraY, like Tilemap::render does. Each strip is filled
+    // with the background colour first.
+    class ScrollingLayer
+    {
+        private:
+            Image* buffer;
+            Color background;
+            // The world position of the window the buffer holds, if valid.
+            int cameraX, cameraY;
+            bool valid;
+
+            // x mod size, always positive.
+            static int wrap(int x, int size)
+            {
+                int result = x % size;
+                return result < 0 ? result + size : result;
+            }
+
+            // Renders the world area x, y - x2, y2, which must fit in the buffer, into the
+            // parts of the buffer where it wraps around to.
+            template<typename RenderFunction> void renderArea(int x, int y, int x2, int y2, RenderFunction render)
+            {
+                if(x > x2 || y > y2)
+                {
+                    return;
+                }
+
+                int width = buffer->getWidth();
+                int height = buffer->getHeight();
+                int bufferX = wrap(x, width);
+                int bufferY = wrap(y, height);
+                // The area splits where it crosses the buffer's right and bottom edges.
+                int splitX = std::min(x2, x + width - 1 - bufferX);
+                int splitY = std::min(y2, y + height - 1 - bufferY);
+                int pieceX[2] = {x, splitX + 1};
+                int pieceX2[2] = {splitX, x2};
+                int pieceY[2] = {y, splitY + 1};
+                int pieceY2[2] = {splitY, y2};
+                for(int j = 0; j < 2; j++)
+                {
+                    for(int i = 0; i < 2; i++)
+                    {
+                        if(pieceX[i] > pieceX2[i] || pieceY[j] > pieceY2[j])
+                        {
+                            continue;
+                        }
+                        int left = wrap(pieceX[i], width);
+                        int top = wrap(pieceY[j], height);
+                        int right = left + pieceX2[i] - pieceX[i];
+                        int bottom = top + pieceY2[j] - pieceY[j];
+                        buffer->setClip(left, top, right, bottom);
+                        buffer->rectFill(left, top, right, bottom, background, CopyBlender());
+                        render(buffer, pieceX[i] - left, pieceY[j] - top);
+                    }
+                }
+                buffer->resetClip();
+            }
+
+        public:
+            // Width and height are the size of the window, usually the screen or viewport.
+            ScrollingLayer(int width, int height, Color background):
+                buffer(new Image(width, height)),
+                background(background),
+                cameraX(0),
+                cameraY(0),
+                valid(false)
+            {
+            }
+
+            ~ScrollingLayer()
+            {
+                delete buffer;
+            }
+
+            int getWidth() const
+            {
+                return buffer->getWidth();
+            }
+
+            int getHeight() const
+            {
+                return buffer->getHeight();
+            }
+
+            // Lets the buffer use a worker pool for clearing and rendering strips.
+            void setWorkerPool(AbstractWorkerPool* workerPool)
+            {
+                buffer->setWorkerPool(workerPool);
+            }
+
+            // Makes the next update render the whole window again, for when the layer changes all over.
+            void invalidate()
+            {
+                valid = false;
+            }
+
+            // Renders the world area x, y - x2, y2 again right away, for a change
+            // to just part of the layer. Only the part in the window is rendered.
+            template<typename RenderFunction> void redraw(int x, int y, int x2, int y2, RenderFunction render)
+            {
+                if(valid)
+                {
+                    renderArea(std::max(std::min(x, x2), cameraX), std::max(std::min(y, y2), cameraY),
+                        std::min(std::max(x, x2), cameraX + getWidth() - 1), std::min(std::max(y, y2), cameraY + getHeight() - 1), render);
+                }
+            }
+
+            // Moves the window to have its top left at x, y in the world, rendering
+            // what's come into view since the last update.
+            template<typename RenderFunction> void update(int x, int y, RenderFunction render)
+            {
+                int width = getWidth();
+                int height = getHeight();
+                int moveX = x - cameraX;
+                int moveY = y - cameraY;
+                if(!valid || std::abs(moveX) >= width || std::abs(moveY) >= height)
+                {
+                    renderArea(x, y, x + width - 1, y + height - 1, render);
+                }
+                else
+                {
+                    // Columns that came into view, top to bottom, then rows that
+                    // came into view, across the columns that were already there.
+                    int keptX = moveX > 0 ? x : cameraX;
+                    int keptX2 = moveX > 0 ? cameraX + width - 1 : x + width - 1;
+                    if(moveX > 0)
+                    {
+                        renderArea(cameraX + width, y, x + width - 1, y + height - 1, render);
+                    }
+                    else if(moveX < 0)
+                    {
+                        renderArea(x, y, cameraX - 1, y + height - 1, render);
+                    }
+                    if(moveY > 0)
+                    {
+                        renderArea(keptX, cameraY + height, keptX2, y + height - 1, render);
+                    }
+                    else if(moveY < 0)
+                    {
+                        renderArea(keptX, y, keptX2, cameraY - 1, render);
+                    }
+                }
+                cameraX = x;
+                cameraY = y;
+                valid = true;
+            }
+
+            // Draws the window onto dest, with its top left at destX, destY.
+            template<typename BlendFunction> void draw(Image* dest, int destX, int destY, BlendFunction f)
+            {
+                int width = getWidth();
+                int height = getHeight();
+                int bufferX = wrap(cameraX, width);
+                int bufferY = wrap(cameraY, height);
+                int splitX = width - bufferX;
+                int splitY = height - bufferY;
+                buffer->drawRegion(bufferX, bufferY, width - 1, height - 1, destX, destY, dest, f);
+                if(bufferX > 0)
+                {
+                    buffer->drawRegion(0, bufferY, bufferX - 1, height - 1, destX + splitX, destY, dest, f);
+                }
+                if(bufferY > 0)
+                {
+                    buffer->drawRegion(bufferX, 0, width - 1, bufferY - 1, destX, destY + splitY, dest, f);
+                }
+                if(bufferX > 0 && bufferY > 0)
+                {
+                    buffer->drawRegion(0, 0, bufferX - 1, bufferY - 1, destX + splitX, destY + splitY, dest, f);
+                }
+            }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef VG_MAP_TILELAYER_HPP
+#define VG_MAP_TILELAYER_HPP
+
+#include <vector>
+#include <algorithm>
+
+namespace vg
+{
+    // One layer of a map: a grid of tile indices into a Tileset, two bytes each.
+    class TileLayer
+    {
+        public:
+            // Marks a cell with nothing in it.
+            enum { NoTile = 0xFFFF };
+
+        private:
+            int width, height;
+            std::vector<unsigned short> tiles;
+
+        public:
+            TileLayer(int width, int height):
+                width(width),
+                height(height),
+                tiles(width * height, (unsigned short) NoTile)
+            {
+            }
+
+            int getWidth() const
+            {
+                return width;
+            }
+
+            int getHeight() const
+            {
+                return height;
+            }
+
+            // Returns NoTile outside the layer.
+            int getTile(int x, int y) const
+            {
+                if(x < 0 || y < 0 || x >= width || y >= height)
+                {
+                    return NoTile;
+                }
+                return tiles[y * width + x];
+            }
+
+            void setTile(int x, int y, int tile)
+            {
+                if(x >= 0 && y >= 0 && x < width && y < height)
+                {
+                    tiles[y * width + x] = (unsigned short) tile;
+                }
+            }
+
+            void fill(int tile)
+            {
+                std::fill(tiles.begin(), tiles.end(), (unsigned short) tile);
+            }
+
+            // The tile indices of row y, width of them.
+            const unsigned short* getRow(int y) const
+            {
+                return &tiles[y * width];
+            }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,263 @@
+#ifndef VG_MAP_TILEMAP_HPP
+#define VG_MAP_TILEMAP_HPP
+
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "../graphics/blend.hpp"
+#include "../graphics/color.hpp"
+#include "../graphics/span.hpp"
+#include "../graphics/image.hpp"
+#include "tileset.hpp"
+#include "tilelayer.hpp"
+
+namespace vg
+{
+    // A stack of same-sized tile layers over one Tileset, drawn bottom layer first.
+    //
+    // Rendering goes straight at the target's pixels, a tile at a time, using
+    // the tileset's alpha classes: with a Blender that skips transparent pixels,
+    // transparent tiles are skipped, and with one that copies opaque pixels,
+    // opaque tiles are copied a row at a time. Only mixed tiles get blended.
+    // With a worker pool on the target (Image::setWorkerPool), rows of tiles
+    // are drawn in parallel. The tileset image can't share pixels with the target.
+    class Tilemap
+    {
+        private:
+            Tileset* tileset;
+            int width, height;
+            std::vector<TileLayer*> layers;
+            // The floors for renderLayerAbove, kept to save allocating them every frame.
+            std::vector<unsigned char> layerFloors;
+
+            // Rounds towards negative infinity, for tiles left of or above the map.
+            static int divideDown(int a, int b)
+            {
+                return a >= 0 ? a / b : -((b - 1 - a) / b);
+            }
+
+            // Finds the tiles under the target's clipping region. Returns false if there are none.
+            bool getTilesInView(const Image* dest, int cameraX, int cameraY, int& tileX, int& tileY, int& tileX2, int& tileY2) const
+            {
+                int clipX, clipY, clipX2, clipY2;
+                dest->getClip(clipX, clipY, clipX2, clipY2);
+                tileX = std::max(divideDown(clipX + cameraX, tileset->getTileWidth()), 0);
+                tileY = std::max(divideDown(clipY + cameraY, tileset->getTileHeight()), 0);
+                tileX2 = std::min(divideDown(clipX2 + cameraX, tileset->getTileWidth()), width - 1);
+                tileY2 = std::min(divideDown(clipY2 + cameraY, tileset->getTileHeight()), height - 1);
+                return tileX <= tileX2 && tileY <= tileY2;
+            }
+
+            // Draws one layer, leaving out the tiles hidden under opaque tiles of the
+            // layers above. Floors holds, for each tile in view, the lowest layer that
+            // shows there, counted from the first layer being drawn, and level is this
+            // layer counted the same way. Floors can be null to draw every tile.
+            template<typename BlendFunction> void renderLayerAbove(int index, Image* dest, int cameraX, int cameraY, BlendFunction f,
+                const unsigned char* floors, int level)
+            {
+                const TileLayer* layer = layers[index];
+                const Image* image = tileset->getImage();
+                ColorChannel opacity = image->getOpacity();
+                if(BlendTraits<BlendFunction>::SkipsTransparent && classifyOpacity(opacity) == OpacityZero)
+                {
+                    return;
+                }
+
+                int tileX, tileY, tileX2, tileY2;
+                if(!getTilesInView(dest, cameraX, cameraY, tileX, tileY, tileX2, tileY2))
+                {
+                    return;
+                }
+                int tileWidth = tileset->getTileWidth();
+                int tileHeight = tileset->getTileHeight();
+                int clipX, clipY, clipX2, clipY2;
+                dest->getClip(clipX, clipY, clipX2, clipY2);
+
+                // Mark everything the tiles can cover dirty at once, rather than tile by tile.
+                Color* destData = dest->getRawData(
+                    std::max(tileX * tileWidth - cameraX, clipX),
+                    std::max(tileY * tileHeight - cameraY, clipY),
+                    std::min((tileX2 + 1) * tileWidth - 1 - cameraX, clipX2),
+                    std::min((tileY2 + 1) * tileHeight - 1 - cameraY, clipY2));
+                int destPitch = dest->getPitch();
+                const Color* sourceData = image->getRawData();
+                int sourcePitch = image->getPitch();
+                bool skipTransparent = BlendTraits<BlendFunction>::SkipsTransparent != 0;
+                bool copyOpaque = BlendTraits<BlendFunction>::CopiesOpaque && classifyOpacity(opacity) == OpacityFull;
+
+                // Each row of tiles writes its own rows of the target.
+                auto drawRow = [&](int row)
+                {
+                    int tileRow = tileY + row;
+                    const unsigned short* tiles = layer->getRow(tileRow);
+                    const unsigned char* rowFloors = floors ? floors + row * (tileX2 - tileX + 1) : 0;
+                    int top = tileRow * tileHeight - cameraY;
+                    int y = std::max(top, clipY);
+                    int y2 = std::min(top + tileHeight - 1, clipY2);
+                    for(int tileColumn = tileX; tileColumn <= tileX2; tileColumn++)
+                    {
+                        int tile = tiles[tileColumn];
+                        if(!tileset->isValidTile(tile) || (rowFloors && rowFloors[tileColumn - tileX] > level))
+                        {
+                            continue;
+                        }
+                        AlphaClass alpha = tileset->getTileAlpha(tile);
+                        if(alpha == AlphaTransparent && skipTransparent)
+                        {
+                            continue;
+                        }
+
+                        int left = tileColumn * tileWidth - cameraX;
+                        int x = std::max(left, clipX);
+                        int x2 = std::min(left + tileWidth - 1, clipX2);
+                        int sourceX, sourceY;
+                        tileset->getTileSource(tile, sourceX, sourceY);
+                        const Color* source = sourceData + (sourceY + y - top) * sourcePitch + sourceX + x - left;
+                        Color* target = destData + y * destPitch + x;
+                        int count = x2 - x + 1;
+                        if(alpha == AlphaOpaque && copyOpaque)
+                        {
+                            for(int i = y; i <= y2; i++, source += sourcePitch, target += destPitch)
+                            {
+                                std::memcpy(target, source, count * sizeof(Color));
+                            }
+                        }
+                        else
+                        {
+                            for(int i = y; i <= y2; i++, source += sourcePitch, target += destPitch)
+                            {
+                                blendSpan(source, target, count, opacity, f);
+                            }
+                        }
+                    }
+                };
+
+                int rows = tileY2 - tileY + 1;
+                AbstractWorkerPool* pool = dest->getWorkerPool();
+                if(pool && pool->getThreadCount() > 1 && rows > 1)
+                {
+                    runTask(pool, rows, drawRow);
+                }
+                else
+                {
+                    for(int row = 0; row < rows; row++)
+                    {
+                        drawRow(row);
+                    }
+                }
+            }
+
+        public:
+            // Width and height are in tiles.
+            Tilemap(Tileset* tileset, int width, int height):
+                tileset(tileset),
+                width(width),
+                height(height)
+            {
+            }
+
+            ~Tilemap()
+            {
+                for(size_t i = 0; i < layers.size(); i++)
+                {
+                    delete layers[i];
+                }
+            }
+
+            Tileset* getTileset() const
+            {
+                return tileset;
+            }
+
+            int getWidth() const
+            {
+                return width;
+            }
+
+            int getHeight() const
+            {
+                return height;
+            }
+
+            // Adds an empty layer on top of the others. It belongs to the map.
+            TileLayer* addLayer()
+            {
+                layers.push_back(new TileLayer(width, height));
+                return layers.back();
+            }
+
+            int getLayerCount() const
+            {
+                return int(layers.size());
+            }
+
+            TileLayer* getLayer(int index) const
+            {
+                return layers[index];
+            }
+
+            // Draws one layer into the target's clipping region, with the map's top
+            // left corner at -cameraX, -cameraY. Uses the tileset image's opacity.
+            template<typename BlendFunction> void renderLayer(int index, Image* dest, int cameraX, int cameraY, BlendFunction f)
+            {
+                renderLayerAbove(index, dest, cameraX, cameraY, f, 0, 0);
+            }
+
+            // Draws layers first..last, bottom first. When opaque tiles get copied
+            // outright, a tile under an opaque tile of a higher layer can't show,
+            // so those are found up front and never drawn.
+            template<typename BlendFunction> void renderLayers(int first, int last, Image* dest, int cameraX, int cameraY, BlendFunction f)
+            {
+                int tileX, tileY, tileX2, tileY2;
+                bool culling = BlendTraits<BlendFunction>::CopiesOpaque
+                    && classifyOpacity(tileset->getImage()->getOpacity()) == OpacityFull
+                    && last > first && last - first <= 255
+                    && getTilesInView(dest, cameraX, cameraY, tileX, tileY, tileX2, tileY2);
+                if(!culling)
+                {
+                    for(int i = first; i <= last; i++)
+                    {
+                        renderLayer(i, dest, cameraX, cameraY, f);
+                    }
+                    return;
+                }
+
+                // Each opaque tile raises the floor under it to its own layer, so the
+                // topmost one wins.
+                int columns = tileX2 - tileX + 1;
+                layerFloors.assign(columns * (tileY2 - tileY + 1), 0);
+                for(int i = first; i <= last; i++)
+                {
+                    unsigned char* floor = &layerFloors[0];
+                    for(int y = tileY; y <= tileY2; y++)
+                    {
+                        const unsigned short* tiles = layers[i]->getRow(y);
+                        for(int x = tileX; x <= tileX2; x++, floor++)
+                        {
+                            int tile = tiles[x];
+                            if(tileset->isValidTile(tile) && tileset->getTileAlpha(tile) == AlphaOpaque)
+                            {
+                                *floor = (unsigned char) (i - first);
+                            }
+                        }
+                    }
+                }
+
+                for(int i = first; i <= last; i++)
+                {
+                    renderLayerAbove(i, dest, cameraX, cameraY, f, i < last ? &layerFloors[0] : 0, i - first);
+                }
+            }
+
+            // Draws every layer, bottom first.
+            template<typename BlendFunction> void render(Image* dest, int cameraX, int cameraY, BlendFunction f)
+            {
+                if(!layers.empty())
+                {
+                    renderLayers(0, int(layers.size()) - 1, dest, cameraX, cameraY, f);
+                }
+            }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,105 @@
+#ifndef VG_MAP_TILESET_HPP
+#define VG_MAP_TILESET_HPP
+
+#include <vector>
+#include "../graphics/blend.hpp"
+#include "../graphics/color.hpp"
+#include "../graphics/span.hpp"
+#include "../graphics/image.hpp"
+
+namespace vg
+{
+    // A grid of same-sized tiles cut from one Image, numbered left to right,
+    // then top to bottom. Any partial tiles at the right and bottom edges are
+    // left out.
+    //
+    // The alpha of every tile is classified up front, so the map renderer can
+    // skip transparent tiles and copy opaque ones without looking at their
+    // pixels. Call classify() again after changing the image.
+    class Tileset
+    {
+        private:
+            Image* image;
+            int tileWidth, tileHeight;
+            int columns, rows;
+            std::vector<AlphaClass> tileAlpha;
+
+        public:
+            Tileset(Image* image, int tileWidth, int tileHeight):
+                image(image),
+                tileWidth(tileWidth),
+                tileHeight(tileHeight),
+                columns(image->getWidth() / tileWidth),
+                rows(image->getHeight() / tileHeight)
+            {
+                classify();
+            }
+
+            // Works out the AlphaClass of every tile from the image's pixels.
+            void classify()
+            {
+                const Image* pixels = image;
+                tileAlpha.resize(columns * rows);
+                for(int tile = 0; tile < columns * rows; tile++)
+                {
+                    const Color* source = pixels->getRawData()
+                        + tile / columns * tileHeight * pixels->getPitch()
+                        + tile % columns * tileWidth;
+                    bool opaque = false;
+                    bool transparent = false;
+                    bool variable = false;
+                    for(int y = 0; y < tileHeight && !variable; y++)
+                    {
+                        switch(classifyAlpha(source + y * pixels->getPitch(), tileWidth))
+                        {
+                            case AlphaTransparent: transparent = true; break;
+                            case AlphaOpaque: opaque = true; break;
+                            case AlphaBinary: opaque = transparent = true; break;
+                            default: variable = true; break;
+                        }
+                    }
+                    tileAlpha[tile] = variable ? AlphaVariable : opaque ? (transparent ? AlphaBinary : AlphaOpaque) : AlphaTransparent;
+                }
+            }
+
+            Image* getImage() const
+            {
+                return image;
+            }
+
+            int getTileWidth() const
+            {
+                return tileWidth;
+            }
+
+            int getTileHeight() const
+            {
+                return tileHeight;
+            }
+
+            int getTileCount() const
+            {
+                return columns * rows;
+            }
+
+            bool isValidTile(int tile) const
+            {
+                return tile >= 0 && tile < columns * rows;
+            }
+
+            // Whether a tile is fully transparent, fully opaque, or mixed (AlphaBinary or AlphaVariable).
+            AlphaClass getTileAlpha(int tile) const
+            {
+                return tileAlpha[tile];
+            }
+
+            // The top left pixel of a tile in the image.
+            void getTileSource(int tile, int& x, int& y) const
+            {
+                x = tile % columns * tileWidth;
+                y = tile / columns * tileHeight;
+            }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -1,14 +1,14 @@
-#ifndef VG_SCRIPT_GLOBAL_HPP
-#define VG_SCRIPT_GLOBAL_HPP
-
-#include "script.hpp"
-
-namespace vg
-{
-    namespace script
-    {
-        void bindLibrary(lua_State* L);
-    }
-}
-
+#ifndef VG_SCRIPT_GLOBAL_HPP
+#define VG_SCRIPT_GLOBAL_HPP
+
+#include "script.hpp"
+
+namespace vg
+{
+    namespace script
+    {
+        void bindLibrary(lua_State* L);
+    }
+}
+
 #endif
\ No newline at end of file